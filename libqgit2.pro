@@ -13,8 +13,11 @@ QMAKE_CXXFLAGS += -std=c++11
 # Input
 HEADERS += libqgit2_export.h \
            qgit2.h \
+           src/qgitaheadbehind.h \
            src/qgitblob.h \
            src/qgitcommit.h \
+           src/qgitcommitbatch.h \
+           src/qgitcommitgraph.h \
            src/qgitconfig.h \
            src/qgitdatabase.h \
            src/qgitdatabasebackend.h \
@@ -22,18 +25,30 @@ HEADERS += libqgit2_export.h \
            src/qgitindex.h \
            src/qgitindexentry.h \
            src/qgitindexmodel.h \
+           src/qgitmappeddatabasebackend.h \
            src/qgitobject.h \
+           src/qgitobjectcache.h \
            src/qgitoid.h \
+           src/qgitpathwalk.h \
+           src/qgitrawobject.h \
+           src/qgitreachabilityindex.h \
            src/qgitref.h \
            src/qgitrepository.h \
+           src/qgitrevspec.h \
            src/qgitrevwalk.h \
            src/qgitsignature.h \
+           src/qgitstatusengine.h \
+           src/qgitstatuswatcher.h \
            src/qgittag.h \
+           src/qgittopowalk.h \
            src/qgittree.h \
            src/qgittreeentry.h \
            src
-SOURCES += src/qgitblob.cpp \
+SOURCES += src/qgitaheadbehind.cpp \
+           src/qgitblob.cpp \
            src/qgitcommit.cpp \
+           src/qgitcommitbatch.cpp \
+           src/qgitcommitgraph.cpp \
            src/qgitconfig.cpp \
            src/qgitdatabase.cpp \
            src/qgitdatabasebackend.cpp \
@@ -41,18 +56,41 @@ SOURCES += src/qgitblob.cpp \
            src/qgitindex.cpp \
            src/qgitindexentry.cpp \
            src/qgitindexmodel.cpp \
+           src/qgitmappeddatabasebackend.cpp \
            src/qgitobject.cpp \
+           src/qgitobjectcache.cpp \
            src/qgitoid.cpp \
+           src/qgitpathwalk.cpp \
+           src/qgitrawobject.cpp \
+           src/qgitreachabilityindex.cpp \
            src/qgitref.cpp \
            src/qgitrepository.cpp \
+           src/qgitrevspec.cpp \
            src/qgitrevwalk.cpp \
            src/qgitsignature.cpp \
+           src/qgitstatusengine.cpp \
+           src/qgitstatuswatcher.cpp \
            src/qgittag.cpp \
+           src/qgittopowalk.cpp \
            src/qgittree.cpp \
            src/qgittreeentry.cpp \
 
 HEADERS += \
-    src/qgitdiff.h
+    src/qgitblame.h \
+    src/qgitdiff.h \
+    src/qgitdiffbatch.h \
+    src/qgitdiffresult.h \
+    src/qgitdiffsink.h \
+    src/qgitdiffstats.h \
+    src/qgitintralinediff.h \
+    src/qgitsimilaritycache.h
 
 SOURCES += \
-    src/qgitdiff.cpp
+    src/qgitblame.cpp \
+    src/qgitdiff.cpp \
+    src/qgitdiffbatch.cpp \
+    src/qgitdiffresult.cpp \
+    src/qgitdiffsink.cpp \
+    src/qgitdiffstats.cpp \
+    src/qgitintralinediff.cpp \
+    src/qgitsimilaritycache.cpp
@@ -28,21 +28,40 @@
 #include "src/qgitoid.h"
 #include "src/qgitsignature.h"
 #include "src/qgitdatabase.h"
+#include "src/qgitmappeddatabasebackend.h"
+#include "src/qgitrawobject.h"
+#include "src/qgitobjectcache.h"
 
 #include "src/qgitrepository.h"
 #include "src/qgitrevwalk.h"
+#include "src/qgitrevspec.h"
 #include "src/qgitref.h"
 #include "src/qgitexception.h"
 
 #include "src/qgitobject.h"
 #include "src/qgitblob.h"
 #include "src/qgitcommit.h"
+#include "src/qgitcommitbatch.h"
+#include "src/qgitcommitgraph.h"
+#include "src/qgitreachabilityindex.h"
+#include "src/qgittopowalk.h"
+#include "src/qgitpathwalk.h"
+#include "src/qgitaheadbehind.h"
 #include "src/qgittag.h"
 #include "src/qgittree.h"
 #include "src/qgittreeentry.h"
 
 #include "src/qgitindex.h"
+#include "src/qgitstatusengine.h"
+#include "src/qgitstatuswatcher.h"
 
+#include "src/qgitblame.h"
 #include "src/qgitdiff.h"
+#include "src/qgitdiffbatch.h"
+#include "src/qgitdiffresult.h"
+#include "src/qgitdiffsink.h"
+#include "src/qgitdiffstats.h"
+#include "src/qgitintralinediff.h"
+#include "src/qgitsimilaritycache.h"
 
 #endif
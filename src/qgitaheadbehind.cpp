@@ -0,0 +1,443 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitaheadbehind.h"
+
+#include "qgitcommitgraph.h"
+#include "qgitexception.h"
+#include "qgitrepository.h"
+
+#include <QtCore/QHash>
+
+#include <git2/commit.h>
+
+#include <queue>
+#include <string.h>
+
+namespace LibQGit2
+{
+
+namespace
+{
+
+inline int lowestBit(quint64 word)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+    while (!(word & 1))
+    {
+        word >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+/**
+ * A commit is done when every starting point reaches it and it is below a
+ * merge base of every tip; nothing it leads to can change the result.
+ */
+bool isDone(const quint64 *mask, const quint64 *stale, const QVector<quint64> &allBits,
+            const QVector<quint64> &tipBits)
+{
+    for (int w = 0; w < allBits.size(); ++w)
+    {
+        if (mask[w] != allBits.at(w) || (stale[w] & tipBits.at(w)) != tipBits.at(w))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Entry
+{
+    qint64 key;
+    int slot;
+
+    bool operator<(const Entry &other) const
+    {
+        if (key != other.key)
+        {
+            return key < other.key;
+        }
+        return slot > other.slot;
+    }
+};
+
+/**
+ * The commits met by the walk. Bit 0 of a mask stands for the base and
+ * bit i + 1 for tip i. A stale bit i + 1 means the commit is below a merge
+ * base of tip i already found.
+ */
+class Walker
+{
+public:
+    enum State
+    {
+        New,
+        Queued,
+        Popped
+    };
+
+    Walker(const QGitRepository &repo, const QGitCommitGraph *graph, int bits)
+        : m_repo(repo)
+        , m_graph(graph)
+        , m_words((bits + 63) / 64)
+    {
+        if (m_graph)
+        {
+            m_graphSlots.fill(-1, m_graph->count());
+        }
+    }
+
+    int words() const
+    {
+        return m_words;
+    }
+
+    int slot(const QGitOId &oid)
+    {
+        if (m_graph)
+        {
+            return slotForPos(m_graph->find(oid));
+        }
+
+        QHash<QGitOId, int>::const_iterator it = m_commitSlots.constFind(oid);
+        if (it != m_commitSlots.constEnd())
+        {
+            return it.value();
+        }
+
+        git_commit *commit = NULL;
+        qGitThrow(git_commit_lookup(&commit, m_repo.data(), oid.constData()));
+
+        QList<QGitOId> parents;
+        const unsigned count = git_commit_parentcount(commit);
+        for (unsigned n = 0; n < count; ++n)
+        {
+            parents.append(QGitOId(git_commit_parent_id(commit, n)));
+        }
+        const qint64 time = git_commit_time(commit);
+        git_commit_free(commit);
+
+        const int s = add(time);
+        m_oids.append(oid);
+        m_parentOids.append(parents);
+        m_commitSlots.insert(oid, s);
+        return s;
+    }
+
+    void parents(int s, QVector<int> &out)
+    {
+        out.clear();
+        if (m_graph)
+        {
+            const int pos = m_positions.at(s);
+            const int count = m_graph->parentCount(pos);
+            for (int n = 0; n < count; ++n)
+            {
+                const int parent = m_graph->parent(pos, n);
+                if (parent != QGitCommitGraph::NotFound)
+                {
+                    out.append(slotForPos(parent));
+                }
+            }
+            return;
+        }
+
+        // slot() may grow m_parentOids, so iterate over a copy
+        const QList<QGitOId> parentOids = m_parentOids.at(s);
+        foreach (const QGitOId &parent, parentOids)
+        {
+            out.append(slot(parent));
+        }
+    }
+
+    QGitOId oid(int s) const
+    {
+        return m_graph ? m_graph->oid(m_positions.at(s)) : m_oids.at(s);
+    }
+
+    qint64 key(int s) const
+    {
+        return m_keys.at(s);
+    }
+
+    quint64 *mask(int s)
+    {
+        return m_masks.data() + s * m_words;
+    }
+
+    quint64 *stale(int s)
+    {
+        return m_stale.data() + s * m_words;
+    }
+
+    uchar &state(int s)
+    {
+        return m_states[s];
+    }
+
+private:
+    int slotForPos(int pos)
+    {
+        int &s = m_graphSlots[pos];
+        if (s < 0)
+        {
+            s = add(m_graph->generation(pos));
+            m_positions.append(pos);
+        }
+        return s;
+    }
+
+    int add(qint64 key)
+    {
+        m_keys.append(key);
+        m_masks.insert(m_masks.end(), m_words, 0);
+        m_stale.insert(m_stale.end(), m_words, 0);
+        m_states.append(New);
+        return m_keys.size() - 1;
+    }
+
+    QGitRepository m_repo;
+    const QGitCommitGraph *m_graph;
+    const int m_words;
+
+    QVector<int> m_graphSlots;          // by graph position
+    QVector<int> m_positions;           // by slot, graph mode
+    QHash<QGitOId, int> m_commitSlots;
+    QVector<QGitOId> m_oids;            // by slot, commit mode
+    QVector<QList<QGitOId> > m_parentOids;
+
+    QVector<qint64> m_keys;
+    QVector<quint64> m_masks;
+    QVector<quint64> m_stale;
+    QVector<uchar> m_states;
+};
+
+}
+
+QGitAheadBehind::QGitAheadBehind()
+{
+}
+
+QGitAheadBehind QGitAheadBehind::compute(const QGitRepository& repository, const QGitOId& base,
+                                         const QList<QGitOId>& tips, const QGitCommitGraph *graph)
+{
+    // generations only order the walk correctly if every start has one
+    if (graph && graph->isOpen())
+    {
+        if (graph->find(base) == QGitCommitGraph::NotFound)
+        {
+            graph = 0;
+        }
+        foreach (const QGitOId &tip, tips)
+        {
+            if (graph && graph->find(tip) == QGitCommitGraph::NotFound)
+            {
+                graph = 0;
+            }
+        }
+    }
+    else
+    {
+        graph = 0;
+    }
+
+    QGitAheadBehind result;
+    result.m_base = base;
+    result.m_tips.resize(tips.size());
+
+    const int bits = tips.size() + 1;
+    Walker walker(repository, graph, bits);
+    const int words = walker.words();
+
+    // every bit, and the bits of the tips
+    QVector<quint64> allBits(words, 0);
+    for (int bit = 0; bit < bits; ++bit)
+    {
+        allBits[bit / 64] |= quint64(1) << (bit % 64);
+    }
+    QVector<quint64> tipBits = allBits;
+    tipBits[0] &= ~quint64(1);
+
+    std::priority_queue<Entry> queue;
+    int undone = 0;     // queued commits that can still change the result
+
+    QVector<int> starts;
+    starts.append(walker.slot(base));
+    walker.mask(starts.last())[0] |= 1;
+    for (int i = 0; i < tips.size(); ++i)
+    {
+        result.m_tips[i].tip = tips.at(i);
+        result.m_tips[i].ahead = 0;
+        result.m_tips[i].behind = 0;
+
+        starts.append(walker.slot(tips.at(i)));
+        walker.mask(starts.last())[(i + 1) / 64] |= quint64(1) << ((i + 1) % 64);
+    }
+
+    foreach (int s, starts)
+    {
+        if (walker.state(s) == Walker::New)
+        {
+            walker.state(s) = Walker::Queued;
+            Entry entry;
+            entry.key = walker.key(s);
+            entry.slot = s;
+            queue.push(entry);
+            if (!isDone(walker.mask(s), walker.stale(s), allBits, tipBits))
+            {
+                ++undone;
+            }
+        }
+    }
+
+    QVector<int> parents;
+    QVector<quint64> mask(words), stale(words);
+    while (undone > 0 && !queue.empty())
+    {
+        const int s = queue.top().slot;
+        queue.pop();
+
+        // parents() may grow the slot arrays, so work on copies
+        walker.state(s) = Walker::Popped;
+        memcpy(mask.data(), walker.mask(s), words * sizeof(quint64));
+        memcpy(stale.data(), walker.stale(s), words * sizeof(quint64));
+        if (!isDone(mask.constData(), stale.constData(), allBits, tipBits))
+        {
+            --undone;
+        }
+
+        const bool fromBase = mask.at(0) & 1;
+        QGitOId oid;
+        for (int w = 0; w < words; ++w)
+        {
+            const quint64 reached = mask.at(w) & tipBits.at(w);
+
+            // ahead: reached from the tip only, behind: from the base only
+            quint64 counted = fromBase ? (~mask.at(w) & tipBits.at(w)) : reached;
+            while (counted)
+            {
+                const int i = w * 64 + lowestBit(counted) - 1;
+                if (fromBase)
+                {
+                    ++result.m_tips[i].behind;
+                }
+                else
+                {
+                    ++result.m_tips[i].ahead;
+                }
+                counted &= counted - 1;
+            }
+
+            if (fromBase)
+            {
+                quint64 bases = reached & ~stale.at(w);
+                while (bases)
+                {
+                    if (!oid.isValid())
+                    {
+                        oid = walker.oid(s);
+                    }
+                    result.m_tips[w * 64 + lowestBit(bases) - 1].mergeBases.append(oid);
+                    bases &= bases - 1;
+                }
+
+                // everything below a merge base is stale for that tip
+                stale[w] |= reached;
+            }
+        }
+
+        walker.parents(s, parents);
+        foreach (int p, parents)
+        {
+            quint64 *parentMask = walker.mask(p);
+            quint64 *parentStale = walker.stale(p);
+            const bool wasDone = isDone(parentMask, parentStale, allBits, tipBits);
+            for (int w = 0; w < words; ++w)
+            {
+                parentMask[w] |= mask.at(w);
+                parentStale[w] |= stale.at(w);
+            }
+            const bool nowDone = isDone(parentMask, parentStale, allBits, tipBits);
+
+            // a commit popped too early (only when ordered by time) is not revisited
+            if (walker.state(p) == Walker::New)
+            {
+                walker.state(p) = Walker::Queued;
+                Entry entry;
+                entry.key = walker.key(p);
+                entry.slot = p;
+                queue.push(entry);
+                if (!nowDone)
+                {
+                    ++undone;
+                }
+            }
+            else if (walker.state(p) == Walker::Queued && !wasDone && nowDone)
+            {
+                --undone;
+            }
+        }
+    }
+
+    return result;
+}
+
+QGitOId QGitAheadBehind::base() const
+{
+    return m_base;
+}
+
+int QGitAheadBehind::tipCount() const
+{
+    return m_tips.size();
+}
+
+QGitOId QGitAheadBehind::tip(int i) const
+{
+    return m_tips.at(i).tip;
+}
+
+int QGitAheadBehind::ahead(int i) const
+{
+    return m_tips.at(i).ahead;
+}
+
+int QGitAheadBehind::behind(int i) const
+{
+    return m_tips.at(i).behind;
+}
+
+QGitOId QGitAheadBehind::mergeBase(int i) const
+{
+    const QList<QGitOId> &bases = m_tips.at(i).mergeBases;
+    return bases.isEmpty() ? QGitOId() : bases.first();
+}
+
+QList<QGitOId> QGitAheadBehind::mergeBases(int i) const
+{
+    return m_tips.at(i).mergeBases;
+}
+
+} // namespace LibQGit2
@@ -0,0 +1,109 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_AHEADBEHIND_H
+#define LIBQGIT2_AHEADBEHIND_H
+
+#include "../libqgit2_export.h"
+
+#include "qgitoid.h"
+
+#include <QtCore/QList>
+#include <QtCore/QVector>
+
+namespace LibQGit2
+{
+    class QGitCommitGraph;
+    class QGitRepository;
+
+    /**
+     * @brief Merge bases and ahead/behind counts of many tips against one base.
+     *
+     * All tips are walked together with the base in a single traversal:
+     * every commit carries one bit per starting point, bits flow from
+     * children to parents, and each commit is visited once however many
+     * tips reach it. The walk stops as soon as every queued commit is
+     * reachable from all starting points and below a merge base of every
+     * tip, since nothing older can change the result.
+     *
+     * Commits are visited by generation number when the commit graph knows
+     * all the starting points, which makes the result exact. Otherwise they
+     * are visited by commit time, which is only exact when commit times do
+     * not go backwards.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_REVWALK_EXPORT QGitAheadBehind
+    {
+        public:
+            QGitAheadBehind();
+
+            /**
+             * Compare every tip with base.
+             * @param graph optional commit graph; not owned
+             * @throws QGitException
+             */
+            static QGitAheadBehind compute(const QGitRepository& repository, const QGitOId& base,
+                                           const QList<QGitOId>& tips, const QGitCommitGraph *graph = 0);
+
+            QGitOId base() const;
+
+            int tipCount() const;
+
+            QGitOId tip(int i) const;
+
+            /**
+             * Number of commits reachable from tip i but not from the base.
+             */
+            int ahead(int i) const;
+
+            /**
+             * Number of commits reachable from the base but not from tip i.
+             */
+            int behind(int i) const;
+
+            /**
+             * Best merge base of tip i and the base, or an invalid id when the
+             * histories are unrelated.
+             */
+            QGitOId mergeBase(int i) const;
+
+            /**
+             * All merge bases of tip i and the base, best first.
+             */
+            QList<QGitOId> mergeBases(int i) const;
+
+        private:
+            struct TipResult
+            {
+                QGitOId tip;
+                QList<QGitOId> mergeBases;
+                int ahead;
+                int behind;
+            };
+
+            QGitOId m_base;
+            QVector<TipResult> m_tips;
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_AHEADBEHIND_H
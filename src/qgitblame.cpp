@@ -0,0 +1,618 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitblame.h"
+
+#include "qgitblob.h"
+#include "qgitcommit.h"
+#include "qgitexception.h"
+#include "qgittree.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
+
+#include <git2/diff.h>
+#include <git2/errors.h>
+#include <git2/tree.h>
+
+#include <algorithm>
+#include <string.h>
+
+namespace LibQGit2
+{
+
+namespace
+{
+
+const char Magic[4] = { 'Q', 'B', 'L', 'M' };
+const quint32 Version = 2;
+
+const qint64 DefaultCacheMaxBytes = 64 * 1024 * 1024;
+// saves between two pruneCache() runs
+const int PruneInterval = 256;
+// how much of a blob git looks at to tell binary content
+const int BinaryProbeSize = 8000;
+
+/**
+ * Lines not attributed yet: lineCount lines starting at finalStart in the
+ * blamed file, and at current in the version being looked at.
+ */
+struct Pending
+{
+    int finalStart;
+    int lineCount;
+    int current;
+};
+
+/**
+ * A hunk of a zero-context diff, as reported by libgit2 (1-based).
+ */
+struct Range
+{
+    int oldStart;
+    int oldLines;
+    int newStart;
+    int newLines;
+};
+
+struct HunkLess
+{
+    bool operator()(const QGitBlame::Hunk &a, const QGitBlame::Hunk &b) const
+    {
+        return a.finalStart < b.finalStart;
+    }
+};
+
+bool blobAt(const QGitTree &tree, const QByteArray &path, git_oid *oid)
+{
+    git_tree_entry *entry = NULL;
+    int err = git_tree_entry_bypath(&entry, tree.data(), path.constData());
+    if (err == GIT_ENOTFOUND)
+    {
+        return false;
+    }
+    qGitThrow(err);
+
+    bool isBlob = git_tree_entry_type(entry) == GIT_OBJ_BLOB;
+    git_oid_cpy(oid, git_tree_entry_id(entry));
+    git_tree_entry_free(entry);
+    return isBlob;
+}
+
+/**
+ * Tell binary content the way git does: a NUL byte near the start.
+ */
+bool isBinary(const QGitBlob &blob)
+{
+    const int size = qMin(blob.rawSize(), BinaryProbeSize);
+    return size > 0 && memchr(blob.rawContent(), '\0', size) != NULL;
+}
+
+struct FileAgeLess
+{
+    bool operator()(const QFileInfo &a, const QFileInfo &b) const
+    {
+        return a.lastModified() < b.lastModified();
+    }
+};
+
+int countLines(const QGitBlob &blob)
+{
+    const char *data = static_cast<const char*>(blob.rawContent());
+    const char *end = data + blob.rawSize();
+
+    int lines = 0;
+    for (const char *p = data; p < end; ++lines)
+    {
+        const char *eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        p = eol ? eol + 1 : end;
+    }
+    return lines;
+}
+
+void attributeAll(const QVector<Pending> &pending, const QGitOId &commit, QVector<QGitBlame::Hunk> &done)
+{
+    foreach (const Pending &p, pending)
+    {
+        QGitBlame::Hunk hunk;
+        hunk.finalStart = p.finalStart;
+        hunk.lineCount = p.lineCount;
+        hunk.commit = commit;
+        hunk.origStart = p.current;
+        done.append(hunk);
+    }
+}
+
+/**
+ * Split pending along the diff between the parent (old) and the current
+ * (new) version: added lines go to commit, the others move on to the
+ * parent with their line numbers shifted. Pending ranges are sorted by
+ * current line, so one pass over the hunks is enough.
+ */
+void mapThroughDiff(const QVector<Pending> &pending, const QVector<Range> &ranges, const QGitOId &commit,
+                    QVector<QGitBlame::Hunk> &done, QVector<Pending> &remaining)
+{
+    int h = 0;
+    int shift = 0;      // new line - old line, before hunk h
+
+    foreach (const Pending &p, pending)
+    {
+        int pos = p.current;
+        int target = p.finalStart;
+        const int end = p.current + p.lineCount;
+
+        while (pos < end)
+        {
+            // a hunk adding no lines sits between new lines, at newStart
+            while (h < ranges.size())
+            {
+                const Range &r = ranges.at(h);
+                const int newBegin = r.newLines > 0 ? r.newStart - 1 : r.newStart;
+                if (newBegin + r.newLines > pos)
+                {
+                    break;
+                }
+                shift += r.newLines - r.oldLines;
+                ++h;
+            }
+
+            int take;
+            if (h < ranges.size() && ranges.at(h).newStart - 1 <= pos && ranges.at(h).newLines > 0)
+            {
+                const Range &r = ranges.at(h);
+                take = qMin(end, r.newStart - 1 + r.newLines) - pos;
+
+                QGitBlame::Hunk hunk;
+                hunk.finalStart = target;
+                hunk.lineCount = take;
+                hunk.commit = commit;
+                hunk.origStart = pos;
+                done.append(hunk);
+            }
+            else
+            {
+                int boundary = end;
+                if (h < ranges.size())
+                {
+                    const Range &r = ranges.at(h);
+                    boundary = qMin(end, r.newLines > 0 ? r.newStart - 1 : r.newStart);
+                }
+                take = boundary - pos;
+
+                Pending moved;
+                moved.finalStart = target;
+                moved.lineCount = take;
+                moved.current = pos - shift;
+                remaining.append(moved);
+            }
+
+            pos += take;
+            target += take;
+        }
+    }
+}
+
+/**
+ * Take the attribution of pending from the cached blame of the version
+ * being looked at.
+ */
+void mapThroughCache(const QVector<Pending> &pending, const QVector<QGitBlame::Hunk> &cached,
+                     QVector<QGitBlame::Hunk> &done)
+{
+    foreach (const Pending &p, pending)
+    {
+        QGitBlame::Hunk key;
+        key.finalStart = p.current;
+        int h = int(std::upper_bound(cached.constBegin(), cached.constEnd(), key, HunkLess()) - cached.constBegin()) - 1;
+
+        int pos = p.current;
+        int target = p.finalStart;
+        const int end = p.current + p.lineCount;
+        while (pos < end && h < cached.size())
+        {
+            const QGitBlame::Hunk &c = cached.at(h);
+            const int take = qMin(end, c.finalStart + c.lineCount) - pos;
+
+            QGitBlame::Hunk hunk;
+            hunk.finalStart = target;
+            hunk.lineCount = take;
+            hunk.commit = c.commit;
+            hunk.origStart = c.origStart + (pos - c.finalStart);
+            done.append(hunk);
+
+            pos += take;
+            target += take;
+            ++h;
+        }
+    }
+}
+
+/**
+ * Sort hunks and merge neighbours that continue each other.
+ */
+void coalesce(QVector<QGitBlame::Hunk> &hunks)
+{
+    std::sort(hunks.begin(), hunks.end(), HunkLess());
+
+    int out = 0;
+    for (int i = 0; i < hunks.size(); ++i)
+    {
+        if (out > 0)
+        {
+            QGitBlame::Hunk &last = hunks[out - 1];
+            const QGitBlame::Hunk &hunk = hunks.at(i);
+            if (last.commit == hunk.commit && last.finalStart + last.lineCount == hunk.finalStart
+                    && last.origStart + last.lineCount == hunk.origStart)
+            {
+                last.lineCount += hunk.lineCount;
+                continue;
+            }
+        }
+        hunks[out++] = hunks.at(i);
+    }
+    hunks.resize(out);
+}
+
+}
+
+extern "C" int blameHunkCallBack(const git_diff_delta *delta, const git_diff_range *range,
+                                 const char *header, size_t header_len, void *payload)
+{
+    Q_UNUSED(delta);
+    Q_UNUSED(header);
+    Q_UNUSED(header_len);
+
+    Range r;
+    r.oldStart = range->old_start;
+    r.oldLines = range->old_lines;
+    r.newStart = range->new_start;
+    r.newLines = range->new_lines;
+    static_cast<QVector<Range>*>(payload)->append(r);
+    return 0;
+}
+
+QGitBlame::QGitBlame(const QGitRepository& repository)
+    : m_repo(repository)
+    , m_cacheEnabled(true)
+    , m_cacheMaxBytes(DefaultCacheMaxBytes)
+    , m_savesSincePrune(-1)
+{
+}
+
+QGitBlame::~QGitBlame()
+{
+}
+
+QString QGitBlame::cachePath(const QGitRepository& repository)
+{
+    return repository.path() + QLatin1String("qgit-blame");
+}
+
+void QGitBlame::setCacheEnabled(bool enabled)
+{
+    m_cacheEnabled = enabled;
+}
+
+bool QGitBlame::cacheEnabled() const
+{
+    return m_cacheEnabled;
+}
+
+void QGitBlame::setCacheMaxBytes(qint64 maxBytes)
+{
+    m_cacheMaxBytes = maxBytes;
+}
+
+qint64 QGitBlame::cacheMaxBytes() const
+{
+    return m_cacheMaxBytes;
+}
+
+qint64 QGitBlame::pruneCache(const QGitRepository& repository, qint64 maxBytes)
+{
+    QList<QFileInfo> files;
+    qint64 total = 0;
+
+    QDir cache(cachePath(repository));
+    foreach (const QFileInfo &dir, cache.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        foreach (const QFileInfo &file, QDir(dir.filePath()).entryInfoList(QDir::Files))
+        {
+            files.append(file);
+            total += file.size();
+        }
+    }
+
+    if (total <= maxBytes)
+    {
+        return total;
+    }
+
+    // every file is written once, for one (path, blob, commit), so the oldest
+    // ones are also the least likely to be asked for again
+    std::sort(files.begin(), files.end(), FileAgeLess());
+    foreach (const QFileInfo &file, files)
+    {
+        if (total <= maxBytes)
+        {
+            break;
+        }
+        if (QFile::remove(file.filePath()))
+        {
+            total -= file.size();
+        }
+    }
+    return total;
+}
+
+QVector<QGitBlame::Hunk> QGitBlame::blame(const QGitCommit& commit, const QString& path)
+{
+    const QByteArray pathBytes = path.toUtf8();
+
+    git_oid oid;
+    if (!blobAt(commit.tree(), pathBytes, &oid))
+    {
+        giterr_set_str(GITERR_INVALID, "the path is not a file in the commit");
+        qGitThrow(GIT_ENOTFOUND);
+    }
+
+    const QGitOId finalBlob(&oid);
+    const QGitOId finalCommit = commit.oid();
+
+    QVector<Hunk> cached;
+    if (m_cacheEnabled && loadCache(pathBytes, finalBlob, finalCommit, cached))
+    {
+        return cached;
+    }
+
+    QGitBlob blob = m_repo.lookupBlob(finalBlob);
+    if (isBinary(blob))
+    {
+        // a diff of binary blobs has no hunks to attribute lines with
+        return QVector<Hunk>();
+    }
+
+    QVector<Pending> pending;
+    const int lines = countLines(blob);
+    if (lines > 0)
+    {
+        Pending all;
+        all.finalStart = 0;
+        all.lineCount = lines;
+        all.current = 0;
+        pending.append(all);
+    }
+
+    QVector<Hunk> done;
+    QGitCommit current = commit;
+    QGitOId currentBlob = finalBlob;
+    bool first = true;
+
+    git_diff_options opts = GIT_DIFF_OPTIONS_INIT;
+    opts.context_lines = 0;
+    opts.interhunk_lines = 0;
+
+    while (!pending.isEmpty())
+    {
+        if (!first && m_cacheEnabled && loadCache(pathBytes, currentBlob, current.oid(), cached))
+        {
+            mapThroughCache(pending, cached, done);
+            break;
+        }
+        first = false;
+
+        if (current.parentCount() == 0)
+        {
+            attributeAll(pending, current.oid(), done);
+            break;
+        }
+
+        QGitCommit parent = current.parent(0);
+        if (!blobAt(parent.tree(), pathBytes, &oid))
+        {
+            // the file was added here
+            attributeAll(pending, current.oid(), done);
+            break;
+        }
+
+        const QGitOId parentBlob(&oid);
+        if (parentBlob != currentBlob)
+        {
+            QGitBlob oldBlob = m_repo.lookupBlob(parentBlob);
+            if (isBinary(oldBlob))
+            {
+                // the file became text here
+                attributeAll(pending, current.oid(), done);
+                break;
+            }
+
+            QVector<Range> ranges;
+            qGitThrow(git_diff_blobs(oldBlob.data(), blob.data(), &opts, NULL, blameHunkCallBack, NULL, &ranges));
+
+            QVector<Pending> remaining;
+            mapThroughDiff(pending, ranges, current.oid(), done, remaining);
+            pending = remaining;
+
+            blob = oldBlob;
+            currentBlob = parentBlob;
+        }
+
+        current = parent;
+    }
+
+    coalesce(done);
+    if (m_cacheEnabled)
+    {
+        saveCache(pathBytes, finalBlob, finalCommit, done);
+    }
+    return done;
+}
+
+QString QGitBlame::cacheFile(const QByteArray& path, const QGitOId& blob, const QGitOId& commit) const
+{
+    // the same content at two paths of a commit has two different histories
+    const QByteArray pathHash = QCryptographicHash::hash(path, QCryptographicHash::Md5).toHex();
+    const QString name = QString::fromLatin1(blob.format());
+    return cachePath(m_repo) + QLatin1Char('/') + name.left(2) + QLatin1Char('/') + name.mid(2)
+            + QLatin1Char('-') + QString::fromLatin1(commit.format())
+            + QLatin1Char('-') + QString::fromLatin1(pathHash);
+}
+
+bool QGitBlame::loadCache(const QByteArray& path, const QGitOId& blob, const QGitOId& commit,
+                          QVector<Hunk>& hunks) const
+{
+    hunks.clear();
+
+    QFile file(cacheFile(path, blob, commit));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::BigEndian);
+
+    char magic[sizeof(Magic)];
+    quint32 version = 0, lineCount = 0, commitCount = 0, hunkCount = 0;
+    in.readRawData(magic, sizeof(magic));
+    in >> version;
+    if (in.status() != QDataStream::Ok || memcmp(magic, Magic, sizeof(Magic)) != 0 || version != Version)
+    {
+        return false;
+    }
+
+    // the file name only holds a hash of the path
+    QByteArray recordedPath;
+    in >> recordedPath >> lineCount >> commitCount;
+    if (in.status() != QDataStream::Ok || recordedPath != path
+            || qint64(commitCount) * GIT_OID_RAWSZ > file.size())
+    {
+        return false;
+    }
+
+    QVector<QGitOId> commits;
+    for (quint32 i = 0; i < commitCount; ++i)
+    {
+        git_oid oid;
+        in.readRawData(reinterpret_cast<char*>(oid.id), GIT_OID_RAWSZ);
+        commits.append(QGitOId(&oid));
+    }
+
+    in >> hunkCount;
+    if (qint64(hunkCount) * 16 > file.size())
+    {
+        return false;
+    }
+
+    // the hunks must cover the file exactly, in order
+    quint32 next = 0;
+    for (quint32 i = 0; i < hunkCount && in.status() == QDataStream::Ok; ++i)
+    {
+        quint32 finalStart = 0, count = 0, index = 0, origStart = 0;
+        in >> finalStart >> count >> index >> origStart;
+        if (finalStart != next || count == 0 || index >= commitCount)
+        {
+            break;
+        }
+
+        Hunk hunk;
+        hunk.finalStart = int(finalStart);
+        hunk.lineCount = int(count);
+        hunk.commit = commits.at(int(index));
+        hunk.origStart = int(origStart);
+        hunks.append(hunk);
+        next += count;
+    }
+
+    if (in.status() != QDataStream::Ok || hunks.size() != int(hunkCount) || next != lineCount)
+    {
+        hunks.clear();
+        return false;
+    }
+    return true;
+}
+
+void QGitBlame::saveCache(const QByteArray& path, const QGitOId& blob, const QGitOId& commit,
+                          const QVector<Hunk>& hunks) const
+{
+    QVector<QGitOId> commits;
+    QHash<QGitOId, quint32> indexes;
+    quint32 lineCount = 0;
+    foreach (const Hunk &hunk, hunks)
+    {
+        if (!indexes.contains(hunk.commit))
+        {
+            indexes.insert(hunk.commit, commits.size());
+            commits.append(hunk.commit);
+        }
+        lineCount += hunk.lineCount;
+    }
+
+    // the cache only saves work, failing to write it is not an error
+    const QString fileName = cacheFile(path, blob, commit);
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+
+    QFile file(fileName + QLatin1String(".lock"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::BigEndian);
+    out.writeRawData(Magic, sizeof(Magic));
+    out << Version << path << lineCount << quint32(commits.size());
+    foreach (const QGitOId &c, commits)
+    {
+        out.writeRawData(reinterpret_cast<const char*>(c.constData()->id), GIT_OID_RAWSZ);
+    }
+
+    out << quint32(hunks.size());
+    foreach (const Hunk &hunk, hunks)
+    {
+        out << quint32(hunk.finalStart) << quint32(hunk.lineCount) << indexes.value(hunk.commit)
+            << quint32(hunk.origStart);
+    }
+
+    file.close();
+    if (out.status() != QDataStream::Ok || file.error() != QFile::NoError)
+    {
+        file.remove();
+        return;
+    }
+
+    QFile::remove(fileName);
+    if (!file.rename(fileName))
+    {
+        file.remove();
+        return;
+    }
+
+    if (m_savesSincePrune < 0 || ++m_savesSincePrune >= PruneInterval)
+    {
+        m_savesSincePrune = 0;
+        pruneCache(m_repo, m_cacheMaxBytes);
+    }
+}
+
+} // namespace LibQGit2
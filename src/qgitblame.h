@@ -0,0 +1,126 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_BLAME_H
+#define LIBQGIT2_BLAME_H
+
+#include "../libqgit2_export.h"
+
+#include "qgitrepository.h"
+#include "qgitoid.h"
+
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+namespace LibQGit2
+{
+    class QGitCommit;
+
+    /**
+     * @brief Line attribution of a file, like "git blame --first-parent".
+     *
+     * The file is followed along the first parents of the commit. Commits
+     * that leave its blob unchanged cost nothing; for the others the lines
+     * still unattributed are mapped through a zero-context diff against the
+     * parent's blob, and the lines the diff adds are attributed to the
+     * commit. Renames are not followed.
+     *
+     * Every result is stored in a cache keyed by (path, blob id, commit id)
+     * in the qgit-blame directory of the git directory. A blame that reaches a
+     * cached ancestor takes the remaining lines from the cache, so blaming a
+     * file again after one new commit costs a single diff. The cache is
+     * kept under a byte budget by dropping its oldest files.
+     *
+     * Binary files have no lines: their blame is empty. Lines of a file
+     * that was binary in an ancestor are attributed to the commit that
+     * made it text.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_DIFF_EXPORT QGitBlame
+    {
+        public:
+            /**
+             * Consecutive lines coming from one commit. Line numbers start at 0.
+             */
+            struct Hunk
+            {
+                int finalStart;     //!< first line in the blamed file
+                int lineCount;
+                QGitOId commit;     //!< commit which introduced the lines
+                int origStart;      //!< first line in the file as of commit
+            };
+
+            explicit QGitBlame(const QGitRepository& repository);
+
+            ~QGitBlame();
+
+            /**
+             * Location of the cache directory of repository.
+             */
+            static QString cachePath(const QGitRepository& repository);
+
+            /**
+             * Read and write the on-disk cache. Enabled by default.
+             */
+            void setCacheEnabled(bool enabled);
+            bool cacheEnabled() const;
+
+            /**
+             * Budget of the on-disk cache, 64 MiB by default. It is enforced
+             * with pruneCache() on the first save and then every few hundred
+             * saves of this object.
+             */
+            void setCacheMaxBytes(qint64 maxBytes);
+            qint64 cacheMaxBytes() const;
+
+            /**
+             * Remove the oldest cache files of repository until the cache
+             * takes no more than maxBytes.
+             * @return the size of the cache afterwards
+             */
+            static qint64 pruneCache(const QGitRepository& repository, qint64 maxBytes);
+
+            /**
+             * Attribute every line of path, as of commit, to the commit that
+             * introduced it.
+             * @return the hunks, sorted and covering every line of the file;
+             * empty for a binary file
+             * @throws QGitException when path is not a file in commit
+             */
+            QVector<Hunk> blame(const QGitCommit& commit, const QString& path);
+
+        private:
+            QString cacheFile(const QByteArray& path, const QGitOId& blob, const QGitOId& commit) const;
+            bool loadCache(const QByteArray& path, const QGitOId& blob, const QGitOId& commit,
+                           QVector<Hunk>& hunks) const;
+            void saveCache(const QByteArray& path, const QGitOId& blob, const QGitOId& commit,
+                           const QVector<Hunk>& hunks) const;
+
+            QGitRepository m_repo;
+            bool m_cacheEnabled;
+            qint64 m_cacheMaxBytes;
+            mutable int m_savesSincePrune;
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_BLAME_H
@@ -24,18 +24,48 @@
 #include "qgittree.h"
 #include "qgitexception.h"
 
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+
 #include <git2/commit.h>
 
+#include <string.h>
+
 namespace LibQGit2
 {
 
+struct QGitCommit::Cache
+{
+    enum Field
+    {
+        Message     = 0x1,
+        Summary     = 0x2,
+        DateTime    = 0x4,
+        Committer   = 0x8,
+        Author      = 0x10
+    };
+
+    Cache() : fields(0) {}
+
+    // copies share the cache and may be read from several threads
+    QMutex mutex;
+    int fields;
+    QString message;
+    QString summary;
+    QDateTime dateTime;
+    QGitSignature committer;
+    QGitSignature author;
+};
+
 QGitCommit::QGitCommit(git_commit *commit)
     : QGitObject(reinterpret_cast<git_object*>(commit))
+    , m_cache(new Cache)
 {
 }
 
 QGitCommit::QGitCommit(const QGitCommit& other)
     : QGitObject(other)
+    , m_cache(other.m_cache)
 {
 }
 
@@ -50,19 +80,47 @@ QGitOId QGitCommit::oid() const
 
 QString QGitCommit::message() const
 {
-    return QString::fromUtf8(git_commit_message(data()));
+    QMutexLocker lock(&m_cache->mutex);
+    if (!(m_cache->fields & Cache::Message))
+    {
+        m_cache->message = QString::fromUtf8(git_commit_message(data()));
+        m_cache->fields |= Cache::Message;
+    }
+    return m_cache->message;
+}
+
+const char* QGitCommit::rawMessage() const
+{
+    return git_commit_message(data());
 }
 
 QString QGitCommit::shortMessage(int maxLen) const
 {
-    return message().left(maxLen).split(QRegExp("(\\r|\\n)")).first();
+    QMutexLocker lock(&m_cache->mutex);
+    if (!(m_cache->fields & Cache::Summary))
+    {
+        // only the first line is decoded
+        const char *raw = git_commit_message(data());
+        const size_t size = strlen(raw);
+        const char *lf = static_cast<const char*>(memchr(raw, '\n', size));
+        const size_t line = lf ? size_t(lf - raw) : size;
+        const char *cr = static_cast<const char*>(memchr(raw, '\r', line));
+
+        m_cache->summary = QString::fromUtf8(raw, int(cr ? cr - raw : line));
+        m_cache->fields |= Cache::Summary;
+    }
+    return m_cache->summary.left(maxLen);
 }
 
 QDateTime QGitCommit::dateTime() const
 {
-    QDateTime dateTime;
-    dateTime.setTime_t(git_commit_time(data()));
-    return dateTime;
+    QMutexLocker lock(&m_cache->mutex);
+    if (!(m_cache->fields & Cache::DateTime))
+    {
+        m_cache->dateTime.setTime_t(git_commit_time(data()));
+        m_cache->fields |= Cache::DateTime;
+    }
+    return m_cache->dateTime;
 }
 
 int QGitCommit::timeOffset() const
@@ -72,12 +130,24 @@ int QGitCommit::timeOffset() const
 
 QGitSignature QGitCommit::committer() const
 {
-    return QGitSignature(git_commit_committer(data()));
+    QMutexLocker lock(&m_cache->mutex);
+    if (!(m_cache->fields & Cache::Committer))
+    {
+        m_cache->committer = QGitSignature(git_commit_committer(data()));
+        m_cache->fields |= Cache::Committer;
+    }
+    return m_cache->committer;
 }
 
 QGitSignature QGitCommit::author() const
 {
-    return QGitSignature(git_commit_author(data()));
+    QMutexLocker lock(&m_cache->mutex);
+    if (!(m_cache->fields & Cache::Author))
+    {
+        m_cache->author = QGitSignature(git_commit_author(data()));
+        m_cache->fields |= Cache::Author;
+    }
+    return m_cache->author;
 }
 
 QGitTree QGitCommit::tree() const
@@ -101,9 +171,7 @@ QGitCommit QGitCommit::parent(unsigned n) const
 
 QGitOId QGitCommit::parentId(unsigned n) const
 {
-    git_oid *parentId;
-    git_commit_parent_id(data(), n);
-    return QGitOId(parentId);
+    return QGitOId(git_commit_parent_id(data(), n));
 }
 
 git_commit* QGitCommit::data() const
@@ -23,6 +23,7 @@
 #include "qgitobject.h"
 
 #include <QtCore/QDateTime>
+#include <QtCore/QSharedPointer>
 
 struct git_commit;
 
@@ -37,6 +38,9 @@ namespace LibQGit2
      * @brief Wrapper class for git_commit.
      * Represents a Git commit object.
      *
+     * The message, summary, date and signatures are decoded on first use and
+     * kept for the lifetime of the commit; copies of a QGitCommit share them.
+     *
      * @ingroup LibQGit2
      * @{
      */
@@ -74,6 +78,12 @@ namespace LibQGit2
              */
             QString message() const;
 
+            /**
+             * Get the full message of a commit as stored, without decoding it.
+             * The pointer stays valid as long as the commit object exists.
+             */
+            const char* rawMessage() const;
+
             /**
              * Get the first part of the commit message (similar to git log --oneline).
              * The string is further cut when a linebreak is found.
@@ -139,6 +149,11 @@ namespace LibQGit2
 
             git_commit* data() const;
             const git_commit* constData() const;
+
+        private:
+            struct Cache;
+
+            QSharedPointer<Cache> m_cache;
     };
 
     /**@}*/
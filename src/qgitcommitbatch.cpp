@@ -0,0 +1,185 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitcommitbatch.h"
+
+#include "qgitoid.h"
+
+#include <git2/commit.h>
+
+#include <string.h>
+
+namespace LibQGit2
+{
+
+QGitCommitBatch::QGitCommitBatch()
+{
+}
+
+QGitCommitBatch::~QGitCommitBatch()
+{
+}
+
+int QGitCommitBatch::count() const
+{
+    return m_records.size();
+}
+
+bool QGitCommitBatch::isEmpty() const
+{
+    return m_records.isEmpty();
+}
+
+void QGitCommitBatch::clear()
+{
+    // resize() keeps the capacity of the vectors, clear() would free it;
+    // a QByteArray only keeps it once reserve() has been called
+    m_records.resize(0);
+    m_parents.resize(0);
+    m_arena.reserve(m_arena.capacity());
+    m_arena.resize(0);
+}
+
+QGitOId QGitCommitBatch::oid(int i) const
+{
+    return QGitOId(&m_records.at(i).oid);
+}
+
+const git_oid* QGitCommitBatch::constOid(int i) const
+{
+    return &m_records.at(i).oid;
+}
+
+int QGitCommitBatch::parentCount(int i) const
+{
+    return int(m_records.at(i).parentCount);
+}
+
+QGitOId QGitCommitBatch::parentId(int i, unsigned n) const
+{
+    const Record &r = m_records.at(i);
+    if (n >= r.parentCount)
+    {
+        return QGitOId();
+    }
+    return QGitOId(&m_parents.at(int(r.parents + n)));
+}
+
+qint64 QGitCommitBatch::time(int i) const
+{
+    return m_records.at(i).time;
+}
+
+int QGitCommitBatch::timeOffset(int i) const
+{
+    return m_records.at(i).timeOffset;
+}
+
+QDateTime QGitCommitBatch::dateTime(int i) const
+{
+    const Record &r = m_records.at(i);
+    QDateTime dateTime;
+    dateTime.setTime_t(uint(r.time));
+    return dateTime;
+}
+
+QByteArray QGitCommitBatch::authorName(int i) const
+{
+    return field(i, AuthorName);
+}
+
+QByteArray QGitCommitBatch::authorEmail(int i) const
+{
+    return field(i, AuthorEmail);
+}
+
+QByteArray QGitCommitBatch::committerName(int i) const
+{
+    return field(i, CommitterName);
+}
+
+QByteArray QGitCommitBatch::committerEmail(int i) const
+{
+    return field(i, CommitterEmail);
+}
+
+QByteArray QGitCommitBatch::field(int i, Field f) const
+{
+    const Record &r = m_records.at(i);
+    return QByteArray::fromRawData(m_arena.constData() + r.offset[f], int(r.length[f]));
+}
+
+void QGitCommitBatch::intern(Record& r, Field f, const char *value)
+{
+    const quint32 length = quint32(strlen(value));
+
+    // the committer is usually the author, and runs of commits share both;
+    // reuse the bytes already stored for this record or the previous one
+    const Record *candidates[2] = { &r, m_records.isEmpty() ? 0 : &m_records.last() };
+    for (int c = 0; c < 2; ++c)
+    {
+        const Record *other = candidates[c];
+        if (other == 0)
+        {
+            continue;
+        }
+
+        const int fields = (other == &r) ? int(f) : int(FieldCount);
+        for (int g = 0; g < fields; ++g)
+        {
+            if (other->length[g] == length
+                    && memcmp(m_arena.constData() + other->offset[g], value, length) == 0)
+            {
+                r.offset[f] = other->offset[g];
+                r.length[f] = length;
+                return;
+            }
+        }
+    }
+
+    r.offset[f] = quint32(m_arena.size());
+    r.length[f] = length;
+    m_arena.append(value, int(length));
+}
+
+void QGitCommitBatch::append(git_commit *commit)
+{
+    Record r;
+    git_oid_cpy(&r.oid, git_commit_id(commit));
+    r.time = git_commit_time(commit);
+    r.timeOffset = git_commit_time_offset(commit);
+
+    r.parents = quint32(m_parents.size());
+    r.parentCount = git_commit_parentcount(commit);
+    for (unsigned n = 0; n < r.parentCount; ++n)
+    {
+        m_parents.append(*git_commit_parent_id(commit, n));
+    }
+
+    const git_signature *author = git_commit_author(commit);
+    const git_signature *committer = git_commit_committer(commit);
+    intern(r, AuthorName, author->name);
+    intern(r, AuthorEmail, author->email);
+    intern(r, CommitterName, committer->name);
+    intern(r, CommitterEmail, committer->email);
+
+    m_records.append(r);
+}
+
+} // namespace LibQGit2
@@ -0,0 +1,129 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_COMMITBATCH_H
+#define LIBQGIT2_COMMITBATCH_H
+
+#include "../libqgit2_export.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDateTime>
+#include <QtCore/QVector>
+
+#include <git2/oid.h>
+
+struct git_commit;
+
+namespace LibQGit2
+{
+    class QGitOId;
+
+    /**
+     * @brief Metadata of a page of commits, filled by QGitRevWalk::next(QGitCommitBatch&, int).
+     *
+     * Every commit is a fixed size record; parent ids live in one shared
+     * vector and author and committer names and emails in one byte arena.
+     * Clearing the batch keeps the allocated memory, so a single batch can
+     * be reused for every page of a long walk.
+     *
+     * Byte arrays returned by this class wrap the arena without copying and
+     * are only valid until the batch is cleared or refilled.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_REVWALK_EXPORT QGitCommitBatch
+    {
+        public:
+            QGitCommitBatch();
+
+            ~QGitCommitBatch();
+
+            /**
+             * Number of commits in the batch.
+             */
+            int count() const;
+
+            bool isEmpty() const;
+
+            /**
+             * Drop all commits, keeping the allocated memory.
+             */
+            void clear();
+
+            QGitOId oid(int i) const;
+
+            const git_oid* constOid(int i) const;
+
+            int parentCount(int i) const;
+
+            QGitOId parentId(int i, unsigned n) const;
+
+            /**
+             * Commit time in seconds since the epoch, and the committer's
+             * offset from UTC in minutes.
+             */
+            qint64 time(int i) const;
+            int timeOffset(int i) const;
+
+            QDateTime dateTime(int i) const;
+
+            QByteArray authorName(int i) const;
+            QByteArray authorEmail(int i) const;
+            QByteArray committerName(int i) const;
+            QByteArray committerEmail(int i) const;
+
+            /**
+             * Append the metadata of commit.
+             */
+            void append(git_commit *commit);
+
+        private:
+            enum Field
+            {
+                AuthorName,
+                AuthorEmail,
+                CommitterName,
+                CommitterEmail,
+                FieldCount
+            };
+
+            struct Record
+            {
+                git_oid oid;
+                qint64 time;
+                qint32 timeOffset;
+                quint32 parents;        // index of the first parent in m_parents
+                quint32 parentCount;
+                quint32 offset[FieldCount];
+                quint32 length[FieldCount];
+            };
+
+            QByteArray field(int i, Field f) const;
+            void intern(Record& r, Field f, const char *value);
+
+            QVector<Record> m_records;
+            QVector<git_oid> m_parents;
+            QByteArray m_arena;
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_COMMITBATCH_H
@@ -0,0 +1,738 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitcommitgraph.h"
+
+#include "qgitexception.h"
+
+#include <QtCore/QBitArray>
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+#include <QtCore/QtEndian>
+
+#include <git2/commit.h>
+#include <git2/errors.h>
+#include <git2/merge.h>
+#include <git2/object.h>
+#include <git2/refs.h>
+#include <git2/revwalk.h>
+
+#include <algorithm>
+#include <queue>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace LibQGit2
+{
+
+/*
+ * File layout, all numbers big endian:
+ *
+ *   "QCGR", version, commit count, reserved        4 x 4 bytes
+ *   fanout: number of commits whose first oid
+ *           byte is <= i, for i in 0..255          256 x 4 bytes
+ *   oids, sorted                                   count x 20 bytes
+ *   per commit: parent 1, parent 2, generation,
+ *               time (high, low)                   count x 20 bytes
+ *   edge count, edges                              4 + edges x 4 bytes
+ *
+ * Parents are positions in the oid table, or NoParent. For commits with
+ * more than two parents, parent 2 is OctopusFlag | index of the first extra
+ * parent in the edge list; the last edge of such a list has LastEdgeFlag set.
+ */
+
+namespace
+{
+
+const char Magic[4] = { 'Q', 'C', 'G', 'R' };
+const quint32 Version = 1;
+const int HeaderSize = 16;
+const int FanoutSize = 256 * 4;
+const int OidSize = GIT_OID_RAWSZ;
+const int DataSize = 20;
+
+const quint32 NoParent = 0xffffffffu;
+const quint32 OctopusFlag = 0x80000000u;
+const quint32 LastEdgeFlag = 0x80000000u;
+
+inline quint32 readUInt32(const uchar *p)
+{
+    return qFromBigEndian<quint32>(p);
+}
+
+struct RevWalkGuard
+{
+    RevWalkGuard() : walk(NULL) {}
+    ~RevWalkGuard() { git_revwalk_free(walk); }
+    git_revwalk *walk;
+};
+
+struct OidLess
+{
+    explicit OidLess(const QVector<git_oid> &oids) : oids(oids) {}
+
+    bool operator()(int a, int b) const
+    {
+        return git_oid_cmp(&oids.at(a), &oids.at(b)) < 0;
+    }
+
+    const QVector<git_oid> &oids;
+};
+
+/**
+ * Newest generation first, then newest commit time.
+ */
+struct TopoLess
+{
+    explicit TopoLess(const QGitCommitGraph *graph) : graph(graph) {}
+
+    bool operator()(int a, int b) const
+    {
+        const quint32 ga = graph->generation(a), gb = graph->generation(b);
+        if (ga != gb)
+        {
+            return ga > gb;
+        }
+        const qint64 ta = graph->time(a), tb = graph->time(b);
+        if (ta != tb)
+        {
+            return ta > tb;
+        }
+        return a < b;
+    }
+
+    const QGitCommitGraph *graph;
+};
+
+/**
+ * Commit the reference name points to, if any.
+ */
+bool peelToCommit(git_repository *repo, const QByteArray &name, git_oid *out)
+{
+    git_oid target;
+    if (git_reference_name_to_id(&target, repo, name.constData()) != 0)
+    {
+        return false;
+    }
+
+    git_object *object = NULL;
+    if (git_object_lookup(&object, repo, &target, GIT_OBJ_ANY) != 0)
+    {
+        return false;
+    }
+
+    git_object *commit = NULL;
+    bool found = git_object_peel(&commit, object, GIT_OBJ_COMMIT) == 0;
+    if (found)
+    {
+        git_oid_cpy(out, git_object_id(commit));
+        git_object_free(commit);
+    }
+    git_object_free(object);
+    return found;
+}
+
+}
+
+QGitCommitGraph::QGitCommitGraph(const QGitRepository& repository)
+    : m_repo(repository)
+    , m_map(0)
+    , m_count(0)
+    , m_fanout(0)
+    , m_oids(0)
+    , m_data(0)
+    , m_edges(0)
+    , m_edgeCount(0)
+{
+}
+
+QGitCommitGraph::~QGitCommitGraph()
+{
+    close();
+}
+
+QString QGitCommitGraph::filePath(const QGitRepository& repository)
+{
+    return repository.path() + QLatin1String("objects/info/qgit-commit-graph");
+}
+
+int QGitCommitGraph::write(const QGitRepository& repository)
+{
+    QList<QGitOId> tips;
+    QStringList names = repository.listReferences();
+    names.prepend(QLatin1String("HEAD"));
+
+    foreach (const QString &name, names)
+    {
+        // tags may point to trees or blobs, unborn HEAD to nothing
+        git_oid oid;
+        if (peelToCommit(repository.data(), QFile::encodeName(name), &oid))
+        {
+            tips.append(QGitOId(&oid));
+        }
+    }
+
+    return write(repository, tips);
+}
+
+int QGitCommitGraph::write(const QGitRepository& repository, const QList<QGitOId>& tips)
+{
+    RevWalkGuard guard;
+    qGitThrow(git_revwalk_new(&guard.walk, repository.data()));
+
+    // parents come out before their children, so generations take one pass
+    git_revwalk_sorting(guard.walk, GIT_SORT_TOPOLOGICAL | GIT_SORT_REVERSE);
+    foreach (const QGitOId &tip, tips)
+    {
+        qGitThrow(git_revwalk_push(guard.walk, tip.constData()));
+    }
+
+    QVector<git_oid> oids;
+    QVector<qint64> times;
+    QVector<int> parentBegin;
+    QVector<git_oid> parentOids;
+
+    git_oid oid;
+    int err;
+    while ((err = git_revwalk_next(&oid, guard.walk)) == 0)
+    {
+        git_commit *commit = NULL;
+        qGitThrow(git_commit_lookup(&commit, repository.data(), &oid));
+
+        oids.append(oid);
+        times.append(git_commit_time(commit));
+        parentBegin.append(parentOids.size());
+        unsigned parents = git_commit_parentcount(commit);
+        for (unsigned n = 0; n < parents; ++n)
+        {
+            parentOids.append(*git_commit_parent_id(commit, n));
+        }
+        git_commit_free(commit);
+    }
+    if (err != GIT_ITEROVER)
+    {
+        qGitThrow(err);
+    }
+
+    const int count = oids.size();
+    parentBegin.append(parentOids.size());
+
+    // order[s] is the walk index of the commit at sorted position s
+    QVector<int> order(count);
+    for (int i = 0; i < count; ++i)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), OidLess(oids));
+
+    // sorted position of every parent, NoParent if it is missing (shallow clones)
+    QVector<quint32> parentPos(parentOids.size());
+    for (int e = 0; e < parentOids.size(); ++e)
+    {
+        int lo = 0, hi = count;
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            if (git_oid_cmp(&oids.at(order.at(mid)), &parentOids.at(e)) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        bool found = lo < count && git_oid_equal(&oids.at(order.at(lo)), &parentOids.at(e));
+        parentPos[e] = found ? quint32(lo) : NoParent;
+    }
+
+    // generations, in walk order so every parent is done before its children
+    QVector<quint32> generation(count);
+    for (int w = 0; w < count; ++w)
+    {
+        quint32 g = 0;
+        for (int e = parentBegin.at(w); e < parentBegin.at(w + 1); ++e)
+        {
+            if (parentPos.at(e) != NoParent)
+            {
+                g = qMax(g, generation.at(order.at(int(parentPos.at(e)))));
+            }
+        }
+        generation[w] = g + 1;
+    }
+
+    QString path = filePath(repository);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QFile file(path + QLatin1String(".lock"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        giterr_set_str(GITERR_OS, file.errorString().toLocal8Bit().constData());
+        qGitThrow(GIT_ERROR);
+    }
+
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::BigEndian);
+    out.writeRawData(Magic, sizeof(Magic));
+    out << Version << quint32(count) << quint32(0);
+
+    int upTo = 0;
+    for (int b = 0; b < 256; ++b)
+    {
+        while (upTo < count && oids.at(order.at(upTo)).id[0] <= b)
+        {
+            ++upTo;
+        }
+        out << quint32(upTo);
+    }
+
+    for (int s = 0; s < count; ++s)
+    {
+        out.writeRawData(reinterpret_cast<const char*>(oids.at(order.at(s)).id), OidSize);
+    }
+
+    QVector<quint32> edges;
+    for (int s = 0; s < count; ++s)
+    {
+        const int w = order.at(s);
+        const int begin = parentBegin.at(w);
+        const int parents = parentBegin.at(w + 1) - begin;
+
+        quint32 p1 = parents > 0 ? parentPos.at(begin) : NoParent;
+        quint32 p2 = parents > 1 ? parentPos.at(begin + 1) : NoParent;
+        if (parents > 2)
+        {
+            p2 = OctopusFlag | quint32(edges.size());
+            for (int e = begin + 1; e < begin + parents; ++e)
+            {
+                edges.append(parentPos.at(e));
+            }
+            edges.last() |= LastEdgeFlag;
+        }
+
+        const quint64 time = quint64(times.at(w));
+        out << p1 << p2 << generation.at(w) << quint32(time >> 32) << quint32(time);
+    }
+
+    out << quint32(edges.size());
+    foreach (quint32 edge, edges)
+    {
+        out << edge;
+    }
+
+    file.close();
+    if (out.status() != QDataStream::Ok || file.error() != QFile::NoError)
+    {
+        file.remove();
+        giterr_set_str(GITERR_OS, "failed to write the commit graph");
+        qGitThrow(GIT_ERROR);
+    }
+
+    // rename() swaps the files in one step: open() sees either the old graph
+    // or the new one, and a failure leaves the old graph in place
+    if (::rename(QFile::encodeName(file.fileName()).constData(), QFile::encodeName(path).constData()) != 0)
+    {
+        file.remove();
+        giterr_set_str(GITERR_OS, "failed to replace the commit graph");
+        qGitThrow(GIT_ERROR);
+    }
+
+    return count;
+}
+
+bool QGitCommitGraph::open()
+{
+    close();
+
+    m_file.setFileName(filePath(m_repo));
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    const qint64 size = m_file.size();
+    const qint64 fixedSize = HeaderSize + FanoutSize + 4;
+    if (size < fixedSize || !(m_map = m_file.map(0, size)))
+    {
+        close();
+        return false;
+    }
+
+    if (memcmp(m_map, Magic, sizeof(Magic)) != 0 || readUInt32(m_map + 4) != Version)
+    {
+        close();
+        return false;
+    }
+
+    const qint64 count = readUInt32(m_map + 8);
+    const qint64 edgesAt = fixedSize - 4 + count * (OidSize + DataSize);
+    if (edgesAt + 4 > size)
+    {
+        close();
+        return false;
+    }
+
+    m_edgeCount = readUInt32(m_map + edgesAt);
+    if (edgesAt + 4 + qint64(m_edgeCount) * 4 != size)
+    {
+        close();
+        return false;
+    }
+
+    // find() trusts the fanout to stay inside the oid table
+    quint32 previous = 0;
+    for (int b = 0; b < 256; ++b)
+    {
+        const quint32 upTo = readUInt32(m_map + HeaderSize + b * 4);
+        if (upTo < previous || upTo > count)
+        {
+            close();
+            return false;
+        }
+        previous = upTo;
+    }
+    if (previous != count)
+    {
+        close();
+        return false;
+    }
+
+    // parent() and the walks built on it trust every position they are given
+    const uchar *data = m_map + HeaderSize + FanoutSize + count * OidSize;
+    for (qint64 i = 0; i < count; ++i)
+    {
+        const quint32 p1 = readUInt32(data + i * DataSize);
+        const quint32 p2 = readUInt32(data + i * DataSize + 4);
+        if ((p1 != NoParent && p1 >= count)
+                || (p2 != NoParent && !(p2 & OctopusFlag) && p2 >= count)
+                || (p2 != NoParent && (p2 & OctopusFlag) && (p2 & ~OctopusFlag) >= m_edgeCount))
+        {
+            close();
+            return false;
+        }
+    }
+    for (quint32 i = 0; i < m_edgeCount; ++i)
+    {
+        if ((readUInt32(m_map + edgesAt + 4 + i * 4) & ~LastEdgeFlag) >= count)
+        {
+            close();
+            return false;
+        }
+    }
+
+    m_count = int(count);
+    m_fanout = m_map + HeaderSize;
+    m_oids = m_fanout + FanoutSize;
+    m_data = m_oids + count * OidSize;
+    m_edges = m_map + edgesAt + 4;
+    return true;
+}
+
+void QGitCommitGraph::close()
+{
+    if (m_map)
+    {
+        m_file.unmap(const_cast<uchar*>(m_map));
+    }
+    m_file.close();
+
+    m_map = 0;
+    m_count = 0;
+    m_fanout = m_oids = m_data = m_edges = 0;
+    m_edgeCount = 0;
+}
+
+bool QGitCommitGraph::isOpen() const
+{
+    return m_map != 0;
+}
+
+int QGitCommitGraph::count() const
+{
+    return m_count;
+}
+
+int QGitCommitGraph::find(const QGitOId& oid) const
+{
+    if (oid.length() < OidSize * 2)
+    {
+        // the graph can not resolve abbreviated ids
+        return NotFound;
+    }
+    return find(oid.constData());
+}
+
+int QGitCommitGraph::find(const git_oid *oid) const
+{
+    if (m_count == 0)
+    {
+        return NotFound;
+    }
+
+    const int first = oid->id[0];
+    int lo = first == 0 ? 0 : int(readUInt32(m_fanout + (first - 1) * 4));
+    int hi = int(readUInt32(m_fanout + first * 4));
+
+    while (lo < hi)
+    {
+        const int mid = (lo + hi) / 2;
+        const int cmp = memcmp(m_oids + mid * OidSize, oid->id, OidSize);
+        if (cmp == 0)
+        {
+            return mid;
+        }
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return NotFound;
+}
+
+QGitOId QGitCommitGraph::oid(int pos) const
+{
+    return QGitOId(reinterpret_cast<const git_oid*>(m_oids + pos * OidSize));
+}
+
+const uchar* QGitCommitGraph::entry(int pos) const
+{
+    return m_data + pos * DataSize;
+}
+
+int QGitCommitGraph::parentCount(int pos) const
+{
+    const uchar *e = entry(pos);
+    if (readUInt32(e) == NoParent)
+    {
+        return 0;
+    }
+
+    const quint32 p2 = readUInt32(e + 4);
+    if (p2 == NoParent)
+    {
+        return 1;
+    }
+    if (!(p2 & OctopusFlag))
+    {
+        return 2;
+    }
+
+    int parents = 1;
+    for (quint32 i = p2 & ~OctopusFlag; i < m_edgeCount; ++i)
+    {
+        ++parents;
+        if (readUInt32(m_edges + i * 4) & LastEdgeFlag)
+        {
+            break;
+        }
+    }
+    return parents;
+}
+
+int QGitCommitGraph::parent(int pos, int n) const
+{
+    const uchar *e = entry(pos);
+    quint32 p;
+
+    if (n == 0)
+    {
+        p = readUInt32(e);
+    }
+    else
+    {
+        const quint32 p2 = readUInt32(e + 4);
+        if (!(p2 & OctopusFlag) || p2 == NoParent)
+        {
+            p = n == 1 ? p2 : NoParent;
+        }
+        else
+        {
+            if (n >= parentCount(pos))
+            {
+                return NotFound;
+            }
+            p = readUInt32(m_edges + ((p2 & ~OctopusFlag) + n - 1) * 4) & ~LastEdgeFlag;
+        }
+    }
+
+    return p == NoParent ? int(NotFound) : int(p);
+}
+
+quint32 QGitCommitGraph::generation(int pos) const
+{
+    return readUInt32(entry(pos) + 8);
+}
+
+qint64 QGitCommitGraph::time(int pos) const
+{
+    const uchar *e = entry(pos);
+    return qint64((quint64(readUInt32(e + 12)) << 32) | readUInt32(e + 16));
+}
+
+QGitOId QGitCommitGraph::fallbackMergeBase(const QGitOId& a, const QGitOId& b) const
+{
+    git_oid base;
+    int err = git_merge_base(&base, m_repo.data(), a.constData(), b.constData());
+    if (err == GIT_ENOTFOUND)
+    {
+        return QGitOId();
+    }
+    qGitThrow(err);
+    return QGitOId(&base);
+}
+
+bool QGitCommitGraph::isAncestor(const QGitOId& ancestor, const QGitOId& descendant) const
+{
+    const int target = find(ancestor);
+    const int start = find(descendant);
+    if (target == NotFound || start == NotFound)
+    {
+        return fallbackMergeBase(ancestor, descendant) == ancestor;
+    }
+
+    // every path from start to target only crosses generations above target's
+    const quint32 floor = generation(target);
+    QBitArray seen(m_count);
+    QVector<int> stack;
+    stack.append(start);
+    seen.setBit(start);
+
+    while (!stack.isEmpty())
+    {
+        const int pos = stack.last();
+        stack.pop_back();
+        if (pos == target)
+        {
+            return true;
+        }
+
+        const int parents = parentCount(pos);
+        for (int n = 0; n < parents; ++n)
+        {
+            const int p = parent(pos, n);
+            if (p != NotFound && !seen.testBit(p) && generation(p) >= floor)
+            {
+                seen.setBit(p);
+                stack.append(p);
+            }
+        }
+    }
+    return false;
+}
+
+QGitOId QGitCommitGraph::mergeBase(const QGitOId& a, const QGitOId& b) const
+{
+    const int posA = find(a);
+    const int posB = find(b);
+    if (posA == NotFound || posB == NotFound)
+    {
+        return fallbackMergeBase(a, b);
+    }
+
+    // paint down from both sides in decreasing generation order: a commit's
+    // flags are final once it is popped, and the first commit carrying both
+    // is not an ancestor of any other common ancestor
+    enum { FromA = 1, FromB = 2 };
+    QHash<int, uchar> flags;
+    std::priority_queue<QPair<quint32, int> > queue;
+
+    flags[posA] |= FromA;
+    flags[posB] |= FromB;
+    queue.push(qMakePair(generation(posA), posA));
+    queue.push(qMakePair(generation(posB), posB));
+
+    while (!queue.empty())
+    {
+        const int pos = queue.top().second;
+        queue.pop();
+
+        const uchar f = flags.value(pos);
+        if (f == (FromA | FromB))
+        {
+            return oid(pos);
+        }
+
+        const int parents = parentCount(pos);
+        for (int n = 0; n < parents; ++n)
+        {
+            const int p = parent(pos, n);
+            if (p == NotFound)
+            {
+                continue;
+            }
+
+            uchar &pf = flags[p];
+            if ((pf | f) != pf)
+            {
+                pf |= f;
+                queue.push(qMakePair(generation(p), p));
+            }
+        }
+    }
+
+    return QGitOId();
+}
+
+QList<QGitOId> QGitCommitGraph::topologicalOrder(const QList<QGitOId>& tips) const
+{
+    QBitArray seen(m_count);
+    QVector<int> reached;
+    QVector<int> stack;
+
+    foreach (const QGitOId &tip, tips)
+    {
+        const int pos = find(tip);
+        if (pos != NotFound && !seen.testBit(pos))
+        {
+            seen.setBit(pos);
+            stack.append(pos);
+        }
+    }
+
+    while (!stack.isEmpty())
+    {
+        const int pos = stack.last();
+        stack.pop_back();
+        reached.append(pos);
+
+        const int parents = parentCount(pos);
+        for (int n = 0; n < parents; ++n)
+        {
+            const int p = parent(pos, n);
+            if (p != NotFound && !seen.testBit(p))
+            {
+                seen.setBit(p);
+                stack.append(p);
+            }
+        }
+    }
+
+    // a child's generation is always above its parents'
+    std::sort(reached.begin(), reached.end(), TopoLess(this));
+
+    QList<QGitOId> result;
+    result.reserve(reached.size());
+    foreach (int pos, reached)
+    {
+        result.append(oid(pos));
+    }
+    return result;
+}
+
+} // namespace LibQGit2
@@ -0,0 +1,159 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_COMMITGRAPH_H
+#define LIBQGIT2_COMMITGRAPH_H
+
+#include "../libqgit2_export.h"
+
+#include "qgitrepository.h"
+#include "qgitoid.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QList>
+
+#include <git2/oid.h>
+
+namespace LibQGit2
+{
+    /**
+     * @brief Memory mapped index of the commit history of a repository.
+     *
+     * The graph is stored in objects/info/qgit-commit-graph inside the git
+     * directory. For every commit it holds the commit id, the positions of
+     * its parents, its generation number (1 for root commits, otherwise one
+     * more than the highest generation of its parents) and its commit time.
+     * Commits are addressed by their position in the oid sorted table.
+     *
+     * Queries on commits that are part of the graph never load a commit
+     * object. The graph is a snapshot: commits created after write() are not
+     * part of it until it is written again.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_REVWALK_EXPORT QGitCommitGraph
+    {
+        public:
+            enum { NotFound = -1 };
+
+            explicit QGitCommitGraph(const QGitRepository& repository);
+
+            ~QGitCommitGraph();
+
+            /**
+             * Location of the graph file of repository.
+             */
+            static QString filePath(const QGitRepository& repository);
+
+            /**
+             * Write the graph of every commit reachable from HEAD and the references.
+             * @return the number of commits in the graph
+             * @throws QGitException
+             */
+            static int write(const QGitRepository& repository);
+
+            /**
+             * Write the graph of every commit reachable from tips.
+             * @return the number of commits in the graph
+             * @throws QGitException
+             */
+            static int write(const QGitRepository& repository, const QList<QGitOId>& tips);
+
+            /**
+             * Map the graph file of the repository.
+             * @return false if there is no graph, or it is not valid
+             */
+            bool open();
+
+            void close();
+
+            bool isOpen() const;
+
+            /**
+             * Number of commits in the graph.
+             */
+            int count() const;
+
+            /**
+             * Position of a commit in the graph, or NotFound.
+             */
+            int find(const QGitOId& oid) const;
+            int find(const git_oid *oid) const;
+
+            QGitOId oid(int pos) const;
+
+            int parentCount(int pos) const;
+
+            /**
+             * Position of the n-th parent of the commit at pos, or NotFound.
+             */
+            int parent(int pos, int n) const;
+
+            quint32 generation(int pos) const;
+
+            /**
+             * Commit time in seconds since the epoch.
+             */
+            qint64 time(int pos) const;
+
+            /**
+             * Return true if ancestor is reachable from descendant (a commit is
+             * its own ancestor). Walks down no further than the generation of
+             * ancestor. Falls back to git_merge_base() for commits missing from
+             * the graph.
+             * @throws QGitException
+             */
+            bool isAncestor(const QGitOId& ancestor, const QGitOId& descendant) const;
+
+            /**
+             * A best common ancestor of a and b, or an invalid oid if they have
+             * none. Falls back to git_merge_base() for commits missing from the graph.
+             * @throws QGitException
+             */
+            QGitOId mergeBase(const QGitOId& a, const QGitOId& b) const;
+
+            /**
+             * Every commit reachable from tips, children before their parents
+             * (by decreasing generation, then decreasing commit time). Tips that
+             * are not part of the graph are left out.
+             */
+            QList<QGitOId> topologicalOrder(const QList<QGitOId>& tips) const;
+
+        private:
+            const uchar* entry(int pos) const;
+            QGitOId fallbackMergeBase(const QGitOId& a, const QGitOId& b) const;
+
+            QGitRepository m_repo;
+            QFile m_file;
+            const uchar *m_map;
+            int m_count;
+            const uchar *m_fanout;
+            const uchar *m_oids;
+            const uchar *m_data;
+            const uchar *m_edges;
+            quint32 m_edgeCount;
+
+            Q_DISABLE_COPY(QGitCommitGraph)
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_COMMITGRAPH_H
@@ -19,13 +19,74 @@
 
 #include "qgitdatabase.h"
 
+#include "qgitexception.h"
+
 #include <QtCore/QFile>
 
+#include <git2/errors.h>
 #include <git2/odb.h>
 
+#include <algorithm>
+
 namespace LibQGit2
 {
 
+namespace
+{
+
+struct Request
+{
+    const git_oid *oid;
+    int index;
+};
+
+/**
+ * By id, then by position in the request, so duplicates come out together.
+ */
+struct RequestLess
+{
+    bool operator()(const Request &a, const Request &b) const
+    {
+        const int cmp = git_oid_cmp(a.oid, b.oid);
+        return cmp != 0 ? cmp < 0 : a.index < b.index;
+    }
+};
+
+/**
+ * Read the header of oid into header.
+ * @return false if the database does not have the object
+ */
+bool readObjectHeader(git_odb *odb, const QGitOId &oid, QGitDatabase::ObjectHeader &header)
+{
+    int err;
+    if (oid.length() == GIT_OID_HEXSZ)
+    {
+        err = git_odb_read_header(&header.size, &header.type, odb, oid.constData());
+    }
+    else
+    {
+        // there is no header lookup by prefix
+        git_odb_object *object = NULL;
+        err = git_odb_read_prefix(&object, odb, oid.constData(), oid.length());
+        if (err == 0)
+        {
+            header.type = git_odb_object_type(object);
+            header.size = git_odb_object_size(object);
+            git_odb_object_free(object);
+        }
+    }
+
+    if (err == GIT_ENOTFOUND)
+    {
+        header = QGitDatabase::ObjectHeader();
+        return false;
+    }
+    qGitThrow(err);
+    return true;
+}
+
+}
+
 QGitDatabase::QGitDatabase(git_odb *odb)
     : m_database(odb)
 {
@@ -52,12 +113,12 @@ void QGitDatabase::close()
 
 int QGitDatabase::addBackend(QGitDatabaseBackend *backend, int priority)
 {
-    return git_odb_add_backend(m_database, (git_odb_backend *)backend, priority);
+    return git_odb_add_backend(m_database, backend->data(), priority);
 }
 
 int QGitDatabase::addAlternate(QGitDatabaseBackend *backend, int priority)
 {
-    return git_odb_add_alternate(m_database, (git_odb_backend *)backend, priority);
+    return git_odb_add_alternate(m_database, backend->data(), priority);
 }
 
 int QGitDatabase::exists(QGitDatabase *db, const QGitOId& id)
@@ -65,6 +126,111 @@ int QGitDatabase::exists(QGitDatabase *db, const QGitOId& id)
     return git_odb_exists(db->data(), id.constData());
 }
 
+int QGitDatabase::readMany(const QList<QGitOId>& oids, QVector<QGitRawObject>& objects) const
+{
+    objects.fill(QGitRawObject(), oids.size());
+
+    int found = 0;
+    QVector<Request> requests;
+    requests.reserve(oids.size());
+    for (int i = 0; i < oids.size(); ++i)
+    {
+        const QGitOId &oid = oids.at(i);
+        if (oid.length() == GIT_OID_HEXSZ)
+        {
+            Request request;
+            request.oid = oid.constData();
+            request.index = i;
+            requests.append(request);
+            continue;
+        }
+
+        // abbreviated ids can not be sorted with the others
+        git_odb_object *object = NULL;
+        const int err = git_odb_read_prefix(&object, m_database, oid.constData(), oid.length());
+        if (err != GIT_ENOTFOUND)
+        {
+            qGitThrow(err);
+            objects[i] = QGitRawObject(object);
+            ++found;
+        }
+    }
+
+    std::sort(requests.begin(), requests.end(), RequestLess());
+
+    for (int r = 0; r < requests.size(); ++r)
+    {
+        const Request &request = requests.at(r);
+        if (r > 0 && git_oid_equal(request.oid, requests.at(r - 1).oid))
+        {
+            objects[request.index] = objects.at(requests.at(r - 1).index);
+        }
+        else
+        {
+            git_odb_object *object = NULL;
+            const int err = git_odb_read(&object, m_database, request.oid);
+            if (err != GIT_ENOTFOUND)
+            {
+                qGitThrow(err);
+                objects[request.index] = QGitRawObject(object);
+            }
+        }
+
+        if (!objects.at(request.index).isNull())
+        {
+            ++found;
+        }
+    }
+
+    return found;
+}
+
+QGitDatabase::ObjectHeader QGitDatabase::readHeader(const QGitOId& oid) const
+{
+    ObjectHeader header;
+    readObjectHeader(m_database, oid, header);
+    return header;
+}
+
+int QGitDatabase::readHeaders(const QList<QGitOId>& oids, QVector<ObjectHeader>& headers) const
+{
+    headers.fill(ObjectHeader(), oids.size());
+
+    int found = 0;
+    QVector<Request> requests;
+    requests.reserve(oids.size());
+    for (int i = 0; i < oids.size(); ++i)
+    {
+        Request request;
+        request.oid = oids.at(i).constData();
+        request.index = i;
+        requests.append(request);
+    }
+
+    std::sort(requests.begin(), requests.end(), RequestLess());
+
+    for (int r = 0; r < requests.size(); ++r)
+    {
+        const Request &request = requests.at(r);
+        const QGitOId &oid = oids.at(request.index);
+        if (r > 0 && oid == oids.at(requests.at(r - 1).index))
+        {
+            headers[request.index] = headers.at(requests.at(r - 1).index);
+        }
+        else
+        {
+            readObjectHeader(m_database, oid, headers[request.index]);
+        }
+
+        if (headers.at(request.index).type != GIT_OBJ_BAD)
+        {
+            ++found;
+        }
+    }
+
+    return found;
+}
+
 git_odb* QGitDatabase::data() const
 {
     return m_database;
@@ -24,8 +24,13 @@
 
 #include "qgitdatabasebackend.h"
 #include "qgitoid.h"
+#include "qgitrawobject.h"
 
+#include <QtCore/QList>
 #include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include <git2/types.h>
 
 struct git_odb;
 
@@ -41,6 +46,17 @@ namespace LibQGit2
     class LIBQGIT2_DATABASE_EXPORT QGitDatabase
     {
         public:
+            /**
+             * Type and size of an object, as read from its header.
+             */
+            struct ObjectHeader
+            {
+                ObjectHeader() : type(GIT_OBJ_BAD), size(0) {}
+
+                git_otype type;     // GIT_OBJ_BAD if the object was not found
+                size_t size;
+            };
+
             /**
              * Create a new object database with no backends.
              *
@@ -114,6 +130,47 @@ namespace LibQGit2
              */
             int exists(QGitDatabase *db, const QGitOId& id);
 
+            /**
+             * Read every object of oids into objects, which is resized to
+             * match; objects[i] is the object oids[i], or a null object if
+             * the database does not have it.
+             *
+             * Ids asked for more than once are read once and share the
+             * object. The order of the reads follows the ids, not the
+             * layout of the packs, so it brings no locality of its own.
+             * Reusing the same objects vector across calls keeps its buffer.
+             *
+             * @return the number of objects found
+             * @throws QGitException
+             */
+            int readMany(const QList<QGitOId>& oids, QVector<QGitRawObject>& objects) const;
+
+            /**
+             * Read the type and size of the object oid through
+             * git_odb_read_header().
+             *
+             * Only backends with a header read avoid inflating the object:
+             * the loose backend and QGitMappedDatabaseBackend. The pack
+             * backend of libgit2 0.18 has none, so a packed object is read
+             * whole, deltas resolved, and its size taken from the result.
+             * An abbreviated oid is always read whole.
+             *
+             * @return the header; its type is GIT_OBJ_BAD if the database
+             * does not have the object
+             * @throws QGitException
+             */
+            ObjectHeader readHeader(const QGitOId& oid) const;
+
+            /**
+             * Read the header of every object of oids into headers, which is
+             * resized to match; ids asked for more than once are read once,
+             * like in readMany(). The cost per object is that of readHeader().
+             *
+             * @return the number of objects found
+             * @throws QGitException
+             */
+            int readHeaders(const QList<QGitOId>& oids, QVector<ObjectHeader>& headers) const;
+
             git_odb* data() const;
             const git_odb* constData() const;
 
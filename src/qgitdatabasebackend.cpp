@@ -19,23 +19,222 @@
 
 #include "qgitdatabasebackend.h"
 
+#include "qgitexception.h"
+
 #include <QtCore/QFile>
 
+#include <git2/errors.h>
 #include <git2/odb_backend.h>
 
+#include <stdlib.h>
+#include <string.h>
+
 namespace LibQGit2
 {
 
+extern "C" int backendReadCallBack(void **out, size_t *size, git_otype *type, git_odb_backend *backend,
+                                   const git_oid *oid);
+extern "C" int backendReadPrefixCallBack(git_oid *fullOid, void **out, size_t *size, git_otype *type,
+                                         git_odb_backend *backend, const git_oid *shortOid, size_t length);
+extern "C" int backendReadHeaderCallBack(size_t *size, git_otype *type, git_odb_backend *backend,
+                                         const git_oid *oid);
+extern "C" int backendWriteCallBack(git_oid *oid, git_odb_backend *backend, const void *data, size_t size,
+                                    git_otype type);
+extern "C" int backendExistsCallBack(git_odb_backend *backend, const git_oid *oid);
+extern "C" int backendForeachCallBack(git_odb_backend *backend, git_odb_foreach_cb callback, void *payload);
+extern "C" void backendFreeCallBack(git_odb_backend *backend);
+
+namespace
+{
+
+/**
+ * The git_odb_backend handed to libgit2 for a subclassed backend. libgit2
+ * only sees the first member; the callbacks find the object from there.
+ */
+struct Adapter
+{
+    git_odb_backend parent;
+    QGitDatabaseBackend *owner;
+};
+
+QGitDatabaseBackend* owner(git_odb_backend *backend)
+{
+    return reinterpret_cast<Adapter*>(backend)->owner;
+}
+
+git_odb_backend* newAdapter(QGitDatabaseBackend *owner)
+{
+    Adapter *adapter = new Adapter;
+    git_odb_backend init = GIT_ODB_BACKEND_INIT;
+    adapter->parent = init;
+    adapter->parent.read = backendReadCallBack;
+    adapter->parent.read_prefix = backendReadPrefixCallBack;
+    adapter->parent.read_header = backendReadHeaderCallBack;
+    adapter->parent.write = backendWriteCallBack;
+    adapter->parent.exists = backendExistsCallBack;
+    adapter->parent.foreach = backendForeachCallBack;
+    adapter->parent.free = backendFreeCallBack;
+    adapter->owner = owner;
+    return &adapter->parent;
+}
+
+/**
+ * Report an exception thrown by a virtual function to libgit2. Every
+ * exception is caught in the callbacks: none may unwind through libgit2.
+ */
+int exceptionError(const char *message)
+{
+    giterr_set_str(GITERR_ODB, message);
+    return GIT_ERROR;
+}
+
+/**
+ * Hand data over to libgit2, which frees it itself.
+ */
+int copyOut(git_odb_backend *backend, const QByteArray &data, void **out, size_t *size)
+{
+    *out = git_odb_backend_malloc(backend, data.size());
+    if (*out == NULL)
+    {
+        return GIT_ERROR;
+    }
+    memcpy(*out, data.constData(), data.size());
+    *size = data.size();
+    return 0;
+}
+
+/**
+ * Take over an object buffer allocated by a libgit2 backend.
+ */
+void copyIn(void *buffer, size_t size, QByteArray &data)
+{
+    data = QByteArray(static_cast<const char*>(buffer), int(size));
+    free(buffer);
+}
+
+}
+
+extern "C" int backendReadCallBack(void **out, size_t *size, git_otype *type, git_odb_backend *backend,
+                                   const git_oid *oid)
+{
+    try
+    {
+        QByteArray data;
+        int err = owner(backend)->read(data, type, oid);
+        return err < 0 ? err : copyOut(backend, data, out, size);
+    }
+    catch (const QGitException &e)
+    {
+        return exceptionError(e.message().constData());
+    }
+    catch (...)
+    {
+        return exceptionError("unexpected exception in the object database backend");
+    }
+}
+
+extern "C" int backendReadPrefixCallBack(git_oid *fullOid, void **out, size_t *size, git_otype *type,
+                                         git_odb_backend *backend, const git_oid *shortOid, size_t length)
+{
+    try
+    {
+        QByteArray data;
+        int err = owner(backend)->readPrefix(fullOid, data, type, shortOid, length);
+        return err < 0 ? err : copyOut(backend, data, out, size);
+    }
+    catch (const QGitException &e)
+    {
+        return exceptionError(e.message().constData());
+    }
+    catch (...)
+    {
+        return exceptionError("unexpected exception in the object database backend");
+    }
+}
+
+extern "C" int backendReadHeaderCallBack(size_t *size, git_otype *type, git_odb_backend *backend,
+                                         const git_oid *oid)
+{
+    try
+    {
+        return owner(backend)->readHeader(size, type, oid);
+    }
+    catch (const QGitException &e)
+    {
+        return exceptionError(e.message().constData());
+    }
+    catch (...)
+    {
+        return exceptionError("unexpected exception in the object database backend");
+    }
+}
+
+extern "C" int backendWriteCallBack(git_oid *oid, git_odb_backend *backend, const void *data, size_t size,
+                                    git_otype type)
+{
+    try
+    {
+        return owner(backend)->write(oid, data, size, type);
+    }
+    catch (const QGitException &e)
+    {
+        return exceptionError(e.message().constData());
+    }
+    catch (...)
+    {
+        return exceptionError("unexpected exception in the object database backend");
+    }
+}
+
+extern "C" int backendExistsCallBack(git_odb_backend *backend, const git_oid *oid)
+{
+    try
+    {
+        return owner(backend)->exists(oid) ? 1 : 0;
+    }
+    catch (...)
+    {
+        return 0;
+    }
+}
+
+extern "C" int backendForeachCallBack(git_odb_backend *backend, git_odb_foreach_cb callback, void *payload)
+{
+    try
+    {
+        return owner(backend)->forEachObject(callback, payload);
+    }
+    catch (const QGitException &e)
+    {
+        return exceptionError(e.message().constData());
+    }
+    catch (...)
+    {
+        return exceptionError("unexpected exception in the object database backend");
+    }
+}
+
+extern "C" void backendFreeCallBack(git_odb_backend *backend)
+{
+    // the QGitDatabaseBackend owns the adapter; the database only drops it
+    Q_UNUSED(backend);
+}
+
 QGitDatabaseBackend::QGitDatabaseBackend()
+    : m_databaseBackend(0)
+    , m_adapter(newAdapter(this))
 {
 }
 
 QGitDatabaseBackend::QGitDatabaseBackend( const QGitDatabaseBackend& other )
+    : m_databaseBackend(other.m_databaseBackend)
+    , m_adapter(newAdapter(this))
 {
 }
 
 QGitDatabaseBackend::~QGitDatabaseBackend()
 {
+    delete reinterpret_cast<Adapter*>(m_adapter);
 }
 
 int QGitDatabaseBackend::pack(const QString& objectsDir)
@@ -48,14 +247,99 @@ int QGitDatabaseBackend::loose(const QString& objectsDir)
     return git_odb_backend_loose(&m_databaseBackend, QFile::encodeName(objectsDir), -1, 0);
 }
 
+int QGitDatabaseBackend::read(QByteArray& data, git_otype *type, const git_oid *oid)
+{
+    if (!m_databaseBackend)
+    {
+        return GIT_ENOTFOUND;
+    }
+
+    void *buffer = NULL;
+    size_t size = 0;
+    int err = m_databaseBackend->read(&buffer, &size, type, m_databaseBackend, oid);
+    if (err == 0)
+    {
+        copyIn(buffer, size, data);
+    }
+    return err;
+}
+
+int QGitDatabaseBackend::readPrefix(git_oid *fullOid, QByteArray& data, git_otype *type,
+                                    const git_oid *shortOid, size_t length)
+{
+    if (m_databaseBackend)
+    {
+        void *buffer = NULL;
+        size_t size = 0;
+        int err = m_databaseBackend->read_prefix(fullOid, &buffer, &size, type, m_databaseBackend,
+                                                 shortOid, length);
+        if (err == 0)
+        {
+            copyIn(buffer, size, data);
+        }
+        return err;
+    }
+
+    if (length < GIT_OID_HEXSZ)
+    {
+        return GIT_ENOTFOUND;
+    }
+    git_oid_cpy(fullOid, shortOid);
+    return read(data, type, shortOid);
+}
+
+int QGitDatabaseBackend::readHeader(size_t *size, git_otype *type, const git_oid *oid)
+{
+    if (m_databaseBackend && m_databaseBackend->read_header)
+    {
+        return m_databaseBackend->read_header(size, type, m_databaseBackend, oid);
+    }
+
+    QByteArray data;
+    int err = read(data, type, oid);
+    if (err == 0)
+    {
+        *size = data.size();
+    }
+    return err;
+}
+
+int QGitDatabaseBackend::write(const git_oid *oid, const void *data, size_t size, git_otype type)
+{
+    if (!m_databaseBackend || !m_databaseBackend->write)
+    {
+        giterr_set_str(GITERR_ODB, "the backend is read-only");
+        return GIT_ERROR;
+    }
+
+    // the libgit2 callback only fills the id in, it is already computed
+    git_oid copy;
+    git_oid_cpy(&copy, oid);
+    return m_databaseBackend->write(&copy, m_databaseBackend, data, size, type);
+}
+
+bool QGitDatabaseBackend::exists(const git_oid *oid)
+{
+    return m_databaseBackend && m_databaseBackend->exists(m_databaseBackend, oid);
+}
+
+int QGitDatabaseBackend::forEachObject(git_odb_foreach_cb callback, void *payload)
+{
+    if (!m_databaseBackend || !m_databaseBackend->foreach)
+    {
+        return 0;
+    }
+    return m_databaseBackend->foreach(m_databaseBackend, callback, payload);
+}
+
 git_odb_backend* QGitDatabaseBackend::data() const
 {
-    return m_databaseBackend;
+    return m_databaseBackend ? m_databaseBackend : m_adapter;
 }
 
 const git_odb_backend* QGitDatabaseBackend::constData() const
 {
-    return m_databaseBackend;
+    return data();
 }
 
 } // namespace LibQGit2
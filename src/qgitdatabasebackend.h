@@ -22,8 +22,12 @@
 
 #include "../libqgit2_export.h"
 
+#include <QtCore/QByteArray>
 #include <QtCore/QString>
 
+#include <git2/odb.h>
+#include <git2/types.h>
+
 struct git_odb_backend;
 
 namespace LibQGit2
@@ -32,6 +36,16 @@ namespace LibQGit2
      * @brief Wrapper class for git_odb_backend.
      * Represents a Git object database backend.
      *
+     * Either wraps one of the backends built into libgit2, created with
+     * pack() or loose(), or is subclassed to implement a backend in C++:
+     * data() then returns a git_odb_backend whose callbacks call the
+     * virtual functions below. A subclassed backend must outlive every
+     * database it was added to.
+     *
+     * The virtual functions return 0 on success, GIT_ENOTFOUND when the
+     * object is not stored in this backend, or another libgit2 error code.
+     * A QGitException thrown by them is turned into GIT_ERROR.
+     *
      * @ingroup LibQGit2
      * @{
      */
@@ -42,18 +56,51 @@ namespace LibQGit2
 
             QGitDatabaseBackend( const QGitDatabaseBackend& other );
 
-            ~QGitDatabaseBackend();
+            virtual ~QGitDatabaseBackend();
 
         public:
             int pack(const QString& objectsDir);
 
             int loose(const QString& objectsDir);
 
+            /**
+             * Read the object oid into data.
+             */
+            virtual int read(QByteArray& data, git_otype *type, const git_oid *oid);
+
+            /**
+             * Read the only object whose id starts with the first length hex
+             * digits of shortOid; fullOid receives its id. The default
+             * implementation only handles full ids.
+             */
+            virtual int readPrefix(git_oid *fullOid, QByteArray& data, git_otype *type,
+                                   const git_oid *shortOid, size_t length);
+
+            /**
+             * Read the size and type of the object oid. The default
+             * implementation reads the whole object.
+             */
+            virtual int readHeader(size_t *size, git_otype *type, const git_oid *oid);
+
+            /**
+             * Store an object whose id, computed by the database, is oid.
+             */
+            virtual int write(const git_oid *oid, const void *data, size_t size, git_otype type);
+
+            virtual bool exists(const git_oid *oid);
+
+            /**
+             * Call callback with the id of every object stored; a non zero
+             * return value of callback stops the iteration and is returned.
+             */
+            virtual int forEachObject(git_odb_foreach_cb callback, void *payload);
+
             git_odb_backend* data() const;
             const git_odb_backend* constData() const;
 
         private:
             git_odb_backend *m_databaseBackend;
+            git_odb_backend *m_adapter;     // calls the virtual functions
     };
 
     /**@}*/
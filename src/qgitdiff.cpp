@@ -21,55 +21,130 @@
 #include "qgitdiff.h"
 
 #include <git2/diff.h>
+#include <git2/tree.h>
 
 #include "qgitcommit.h"
+#include "qgitexception.h"
+#include "qgitsimilaritycache.h"
 
 #include <iostream>
 #include <QDebug>
 
+#include <string.h>
+
 namespace LibQGit2
 {
 
-extern "C" int fileDiffCallBack(const git_diff_delta *delta,float progress,void *payload)
+namespace
 {
-    reinterpret_cast<QGitDiff*> (payload)->addFileChanged(delta);
-    // we want to continue looping so return 0
-    return 0;
+
+struct StreamPayload
+{
+    QGitDiffSink *sink;
+};
+
+/**
+ * Fills oid and mode with the entry at path of tree. Returns false if the
+ * tree is null or has no such entry.
+ */
+bool entryByPath(const QGitTree &tree, const QByteArray &path, git_oid *oid, git_filemode_t *mode)
+{
+    if (tree.data() == NULL)
+    {
+        return false;
+    }
+
+    git_tree_entry *entry = NULL;
+    int err = git_tree_entry_bypath(&entry, tree.data(), path.constData());
+    if (err == GIT_ENOTFOUND)
+    {
+        return false;
+    }
+    qGitThrow(err);
+
+    git_oid_cpy(oid, git_tree_entry_id(entry));
+    *mode = git_tree_entry_filemode(entry);
+    git_tree_entry_free(entry);
+    return true;
 }
 
+/**
+ * Return true if path points to the same object on both sides (or to
+ * nothing at all), in which case nothing below it can have changed.
+ */
+bool sameEntry(const QGitTree &treeFrom, const QGitTree &treeTo, const QByteArray &path)
+{
+    git_oid oidFrom, oidTo;
+    git_filemode_t modeFrom, modeTo;
+    bool inFrom = entryByPath(treeFrom, path, &oidFrom, &modeFrom);
+    bool inTo = entryByPath(treeTo, path, &oidTo, &modeTo);
+
+    if (inFrom != inTo)
+    {
+        return false;
+    }
+    return !inFrom || (modeFrom == modeTo && git_oid_equal(&oidFrom, &oidTo));
+}
+
+}
 
-extern "C" int addPatchHunksCallBack( const git_diff_delta *delta, const git_diff_range *range,
-                                        const char *header, size_t header_len, void *payload)
+extern "C" int streamFileCallBack(const git_diff_delta *delta, float progress, void *payload)
 {
-    reinterpret_cast<QGitDiff*> (payload)->addPatchHunks(delta, header, header_len);
-    // we want to continue looping so return 0
-    return 0;
+    // unmodified files are only part of the diff as copy sources
+    if (delta->status == GIT_DELTA_UNMODIFIED)
+    {
+        return 0;
+    }
+
+    QGitDiffSink *sink = static_cast<StreamPayload*>(payload)->sink;
+    // a non zero return value stops the iteration
+    return sink->file(QGitDiffFileView(delta), progress) ? 0 : 1;
 }
 
+extern "C" int streamHunkCallBack(const git_diff_delta *delta, const git_diff_range *range,
+                                  const char *header, size_t header_len, void *payload)
+{
+    QGitDiffSink *sink = static_cast<StreamPayload*>(payload)->sink;
+    return sink->hunk(QGitDiffFileView(delta), QGitDiffHunkView(range, header, header_len)) ? 0 : 1;
+}
 
-extern "C" int addPatchLinesCallBack(const git_diff_delta *delta, const git_diff_range *range,
-                                        char usage, const char *line, size_t line_len, void *payload)
+extern "C" int streamLineCallBack(const git_diff_delta *delta, const git_diff_range *range,
+                                  char usage, const char *line, size_t line_len, void *payload)
 {
-    reinterpret_cast<QGitDiff*> (payload)->addPatchLines(delta, line, usage, line_len);
-    // we want to continue looping so return 0
-    return 0;
+    QGitDiffSink *sink = static_cast<StreamPayload*>(payload)->sink;
+    return sink->line(QGitDiffFileView(delta), QGitDiffHunkView(range),
+                      QGitDiffLineView(usage, line, line_len)) ? 0 : 1;
 }
 
-extern "C" int printCB(  const git_diff_delta *delta, const git_diff_range *range,
-                         char usage, const char *line, size_t line_len, void *payload)
+extern "C" int printRawCallBack(const git_diff_delta *delta, const git_diff_range *range,
+                                char usage, const char *line, size_t line_len, void *payload)
 {
-    reinterpret_cast<QGitDiff*> (payload)->saveFullPatch(line);
+    Q_UNUSED(range);
+    Q_UNUSED(usage);
+
+    if (delta->status == GIT_DELTA_UNMODIFIED)
+    {
+        return 0;
+    }
+
+    // git_diff_print_patch() already starts content lines with their origin
+    static_cast<QByteArray*>(payload)->append(line, int(line_len));
 
     return 0;
 }
 
-
 /**
  * @brief QGitDiff::QGitDiff
  * @param repo the repository which contains the commits to the
  */
 QGitDiff::QGitDiff(QGitRepository repo)
     : _repo (repo)
+    , diff(NULL)
+    , patchesCollected(false)
+    , similarityFlags(NoSimilarity)
+    , similarityThreshold(50)
+    , similarityCandidates(200)
+    , similarityCache(NULL)
 {
 }
 
@@ -80,20 +155,160 @@ QGitDiff::QGitDiff(QGitRepository repo)
  */
 void QGitDiff::diffCommits(QGitCommit commitFrom, QGitCommit commitTo)
 {
-    const git_diff_options opts = GIT_DIFF_OPTIONS_INIT;
+    diffTrees(commitFrom.tree(), commitTo.tree());
+}
+
+void QGitDiff::diffTrees(const QGitTree &treeFrom, const QGitTree &treeTo)
+{
+    git_diff_options opts = options();
+
+    clear();
+
+    // drop the prefixes whose subtree did not change, without opening them
+    QVector<char*> changed;
+    if (!pathSpecStrings.isEmpty() && !similarityFlags.testFlag(FindCopiesFromUnmodified)
+            && pathSpecIsPrefixOnly())
+    {
+        for (int i = 0; i < pathSpecBytes.size(); ++i)
+        {
+            if (!sameEntry(treeFrom, treeTo, pathSpecBytes.at(i)))
+            {
+                changed.append(pathSpecStrings.at(i));
+            }
+        }
+
+        if (changed.isEmpty())
+        {
+            // nothing inside the spec changed; the diff stays empty
+            return;
+        }
+
+        opts.pathspec.strings = changed.data();
+        opts.pathspec.count = changed.size();
+    }
+
+    // only the file list is built here; the patch text is generated on demand
+    qGitThrow(git_diff_tree_to_tree (&diff, _repo.data(), treeFrom.data(), treeTo.data(), &opts));
+    findSimilar();
+}
+
+void QGitDiff::setSimilarityDetection(SimilarityFlags flags, int threshold, int candidateLimit)
+{
+    similarityFlags = flags;
+    similarityThreshold = threshold;
+    similarityCandidates = candidateLimit;
+}
+
+void QGitDiff::setPathSpec(const QStringList &spec)
+{
+    pathSpecBytes.clear();
+    pathSpecStrings.clear();
+
+    foreach (const QString &path, spec)
+    {
+        QByteArray bytes = path.toLocal8Bit();
+        // "dir/" and "dir" select the same subtree
+        while (bytes.size() > 1 && bytes.endsWith('/'))
+        {
+            bytes.chop(1);
+        }
+        pathSpecBytes.append(bytes);
+    }
+
+    for (int i = 0; i < pathSpecBytes.size(); ++i)
+    {
+        pathSpecStrings.append(pathSpecBytes[i].data());
+    }
+}
+
+QStringList QGitDiff::pathSpec() const
+{
+    QStringList spec;
+    foreach (const QByteArray &path, pathSpecBytes)
+    {
+        spec.append(QString::fromLocal8Bit(path));
+    }
+    return spec;
+}
+
+bool QGitDiff::pathSpecIsPrefixOnly() const
+{
+    foreach (const QByteArray &path, pathSpecBytes)
+    {
+        // empty entries, globs and negations are left to libgit2
+        if (path.isEmpty() || path == "." || path.startsWith('!') || path.startsWith(':')
+                || strpbrk(path.constData(), "*?[\\") != NULL)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void QGitDiff::setSimilarityCache(QGitSimilarityCache *cache)
+{
+    similarityCache = cache;
+}
 
-    git_diff_tree_to_tree (&diff, _repo.data(), commitFrom.tree().data(), commitTo.tree().data(), &opts);
+git_diff_options QGitDiff::options() const
+{
+    git_diff_options opts = GIT_DIFF_OPTIONS_INIT;
 
+    if (similarityFlags.testFlag(FindCopiesFromUnmodified))
+    {
+        // unmodified files are only candidates if they are part of the diff
+        opts.flags |= GIT_DIFF_INCLUDE_UNMODIFIED;
+    }
 
-    git_diff_foreach (diff, fileDiffCallBack, addPatchHunksCallBack, addPatchLinesCallBack, this);
+    if (!pathSpecStrings.isEmpty())
+    {
+        // libgit2 only reads the strings, the cast is safe
+        opts.pathspec.strings = const_cast<char**>(pathSpecStrings.constData());
+        opts.pathspec.count = pathSpecStrings.size();
+    }
 
+    return opts;
+}
+
+void QGitDiff::findSimilar()
+{
+    if (!similarityFlags)
+    {
+        return;
+    }
+
+    git_diff_find_options opts = GIT_DIFF_FIND_OPTIONS_INIT;
+
+    if (similarityFlags.testFlag(FindRenames))
+    {
+        opts.flags |= GIT_DIFF_FIND_RENAMES;
+    }
+    if (similarityFlags.testFlag(FindCopies))
+    {
+        opts.flags |= GIT_DIFF_FIND_COPIES;
+    }
+    if (similarityFlags.testFlag(FindCopiesFromUnmodified))
+    {
+        opts.flags |= GIT_DIFF_FIND_COPIES | GIT_DIFF_FIND_COPIES_FROM_UNMODIFIED;
+    }
+
+    opts.rename_threshold = similarityThreshold;
+    opts.copy_threshold = similarityThreshold;
+    opts.target_limit = similarityCandidates;
+
+    if (similarityCache != NULL)
+    {
+        opts.metric = similarityCache->metric();
+    }
+
+    qGitThrow(git_diff_find_similar(diff, &opts));
 }
 
 
 
 QGitDiff::~QGitDiff()
 {
-    git_diff_list_free (diff);
+    clear();
 }
 
 /**
@@ -105,146 +320,173 @@ QGitDiff::~QGitDiff()
  */
 bool QGitDiff::diffWorkingDir()
 {
-    const git_diff_options opts = GIT_DIFF_OPTIONS_INIT;
+    const git_diff_options opts = options();
 
     QGitCommit commit = _repo.lookupCommit(_repo.head().oid());
 
+    clear();
+
     // get the diff
-    git_diff_tree_to_workdir (&diff, _repo.data(), commit.tree().data() , &opts);
+    qGitThrow(git_diff_tree_to_workdir (&diff, _repo.data(), commit.tree().data() , &opts));
+    findSimilar();
 
-    // get the diff in a useful form
-    git_diff_foreach (diff, fileDiffCallBack, addPatchHunksCallBack, addPatchLinesCallBack, this);
+    return git_diff_num_deltas_of_type(diff, GIT_DELTA_UNMODIFIED) < git_diff_num_deltas(diff);
+}
 
-    if (fileList.isEmpty())
+bool QGitDiff::stream(QGitDiffSink *sink, StreamDetail detail) const
+{
+    if (diff == NULL)
+    {
+        return true;
+    }
+
+    StreamPayload payload;
+    payload.sink = sink;
+
+    int err = git_diff_foreach(diff, streamFileCallBack,
+                               detail >= Hunks ? streamHunkCallBack : NULL,
+                               detail >= Lines ? streamLineCallBack : NULL,
+                               &payload);
+    if (err == GIT_EUSER)
     {
         return false;
     }
 
+    qGitThrow(err);
     return true;
 }
 
-void QGitDiff::addPatchLines(const git_diff_delta *delta, const char *line, char usage, int lineLen)
+void QGitDiff::clear()
 {
-    //assumes that this is called after hunk call back so this will
-    // just append to the end of the Last map that was created by addHunk
-    QString fileName(delta->new_file.path);
-    QString currentLine(line);
-    QString realLine = currentLine.left(lineLen);
-
-    patchInfo info = deltas[QString(delta->new_file.path)];
-    QString currentFilePatch = info.patch;
-
-    currentFilePatch.append(usage);
-    currentFilePatch.append(realLine);
-
-    if (usage == '+')
+    if (diff != NULL)
     {
-        //std::cout << "addition is hit " <<  info.additions << std::endl;
-        info.additions = info.additions + 1;
+        git_diff_list_free (diff);
+        diff = NULL;
     }
 
-    if (usage == '-')
-    {
-        //std::cout << "deletions is hit " <<  info.deletions << std::endl;
-        info.deletions = info.deletions + 1;
-    }
-
-    deltas[fileName].patch = currentFilePatch;
-    deltas[fileName].additions = info.additions;
-    deltas[fileName].deletions = info.deletions;
+    diffResult = QGitDiffResult();
+    patchesCollected = false;
 }
 
-
-void QGitDiff::addPatchHunks(const git_diff_delta *delta, const char *header, int headerLen)
+void QGitDiff::collectPatches()
 {
-    QString fileName(delta->new_file.path);
-    QString currentFilePatch = deltas[QString(delta->new_file.path)].patch;
-    QString currentHeader(header);
-    QString realHeader = currentHeader.left(headerLen);
-
-    currentFilePatch.append(realHeader);
+    if (patchesCollected)
+    {
+        return;
+    }
 
-    deltas[fileName].patch = currentFilePatch;
+    QGitDiffResultBuilder builder;
+    stream(&builder);
+    diffResult = builder.result();
+    patchesCollected = true;
 }
 
-void QGitDiff::addFileChanged(const git_diff_delta *delta)
+QGitDiffResult QGitDiff::result()
 {
-    fileList.push_back(QString::fromLocal8Bit(delta->new_file.path));
-    patchInfo info;
-    info.patch = QString();
-    info.additions = 0;
-    info.deletions = 0;
-
-    deltas.insert(QString(delta->new_file.path), info);
+    collectPatches();
+    return diffResult;
 }
 
 QStringList QGitDiff::getFileChangedList()
 {
+    collectPatches();
+
+    QStringList fileList;
+    for (int i = 0; i < diffResult.fileCount(); ++i)
+    {
+        fileList.push_back(QString::fromLocal8Bit(diffResult.path(i)));
+    }
     return fileList;
 }
 
 QString QGitDiff::getDeltasForFile(const QString &file)
 {
-    return deltas[file].patch;
+    return QString::fromUtf8(getRawDeltasForFile(file));
 }
 
-void QGitDiff::saveFullPatch(const char *line)
+QByteArray QGitDiff::getRawDeltasForFile(const QString &file)
 {
-    patch += QString(line);
-}
+    collectPatches();
 
-QString QGitDiff::print()
-{
-    git_diff_print_patch(diff, printCB, this);
+    int i = diffResult.indexOf(file.toLocal8Bit());
+    if (i < 0 || diffResult.isBinary(i))
+    {
+        return QByteArray();
+    }
 
-    return patch;
+    // the slice points into the result, detach it so it outlives the next diff
+    const QByteArray slice = diffResult.patch(i);
+    return QByteArray(slice.constData(), slice.size());
 }
 
-QString QGitDiff::getDiffString(int additions, int deletions)
+QVector<QGitIntraLineDiff::LinePair> QGitDiff::intraLineChanges(const QString &file, int maxEdits) const
 {
-    QString diffStat;
-
-    for (int i = 0; i < additions; i++)
+    QVector<QGitIntraLineDiff::LinePair> pairs;
+    if (diff == NULL)
     {
-        diffStat = diffStat + "+";
+        return pairs;
     }
 
-    for (int i = 0; i < deletions; i++)
+    const QByteArray path = file.toLocal8Bit();
+    size_t count = git_diff_num_deltas(diff);
+    for (size_t i = 0; i < count; ++i)
     {
-        diffStat = diffStat + "-";
+        // look the file up by its delta first, so no other patch is generated
+        const git_diff_delta *delta = NULL;
+        qGitThrow(git_diff_get_patch(NULL, &delta, diff, i));
+        if (delta == NULL || delta->status == GIT_DELTA_UNMODIFIED || path != delta->new_file.path)
+        {
+            continue;
+        }
+
+        git_diff_patch *patch = NULL;
+        qGitThrow(git_diff_get_patch(&patch, NULL, diff, i));
+        try
+        {
+            pairs = QGitIntraLineDiff::fromPatch(patch, maxEdits);
+        }
+        catch (...)
+        {
+            git_diff_patch_free(patch);
+            throw;
+        }
+        git_diff_patch_free(patch);
+        break;
     }
 
-    return diffStat;
+    return pairs;
 }
 
-QString QGitDiff::diffStats()
+QString QGitDiff::print() const
 {
-    QString stats;
-
-    int totalAdditions = 0;
-    int totalDeletions = 0;
+    return QString::fromUtf8(printRaw());
+}
 
-    // check to make sure diff has been populated
+QByteArray QGitDiff::printRaw() const
+{
+    QByteArray out;
     if (diff == NULL)
     {
-        return stats;
+        return out;
     }
 
-    foreach (QString file, fileList)
-    {
-        patchInfo info = deltas[file];
-
+    qGitThrow(git_diff_print_patch(diff, printRawCallBack, &out));
+    return out;
+}
 
-        totalAdditions += info.additions;
-        totalDeletions += info.deletions;
+QGitDiffStats QGitDiff::stats() const
+{
+    return QGitDiffStats::fromDiff(diff);
+}
 
-        stats.append(" " + file + "\t|    " + getDiffString(info.additions, info.deletions) + "\n");
+QString QGitDiff::diffStats(int width)
+{
+    // check to make sure diff has been populated
+    if (diff == NULL)
+    {
+        return QString();
     }
-    stats.append(" " + QString::number(fileList.count()));
-    stats.append(" file changed, " + QString::number(totalAdditions));
-    stats.append(" insertions(+), " + QString::number(totalDeletions));
-    stats.append(" deletions(-)\n");
 
-    return stats;
+    return stats().format(width);
 }
 }
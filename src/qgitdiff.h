@@ -28,15 +28,42 @@
 #include "qgittree.h"
 #include "qgitrepository.h"
 #include "qgittree.h"
+#include "qgitdiffsink.h"
+#include "qgitdiffresult.h"
+#include "qgitdiffstats.h"
+#include "qgitintralinediff.h"
 
 namespace LibQGit2
 {
     class QGitRepository;
     class QGitCommit;
+    class QGitSimilarityCache;
 
     class LIBQGIT2_EXPORT QGitDiff : public QGitObject
     {
     public:
+         /**
+          * Amount of detail QGitDiff::stream() reports to its sink.
+          */
+         enum StreamDetail
+         {
+             Files,      //!< only QGitDiffSink::file() is called
+             Hunks,      //!< file() and hunk() are called
+             Lines       //!< file(), hunk() and line() are called
+         };
+
+         /**
+          * Kinds of similar files git_diff_find_similar() pairs up.
+          */
+         enum SimilarityFlag
+         {
+             NoSimilarity             = 0x0,
+             FindRenames              = 0x1,  //!< pair deleted and added files
+             FindCopies               = 0x2,  //!< pair added files with modified ones
+             FindCopiesFromUnmodified = 0x4   //!< also consider unmodified files as copy sources; slow
+         };
+         Q_DECLARE_FLAGS(SimilarityFlags, SimilarityFlag)
+
          QGitDiff(QGitRepository repo);
 
          virtual ~QGitDiff();
@@ -45,57 +72,169 @@ namespace LibQGit2
 
          QString getDeltasForFile(const QString &file);
 
+         /**
+          * @brief getRawDeltasForFile Same as getDeltasForFile(), but returns the
+          * patch bytes as stored, without decoding them. Binary files have no
+          * patch text.
+          * @throws QGitException
+          */
+         QByteArray getRawDeltasForFile(const QString &file);
+
+         /**
+          * @brief intraLineChanges Pairs up the deleted and added lines of every
+          * hunk of file and reports which words changed inside them. Only the
+          * patch of that file is generated.
+          * @param file path of the file on the new side of the diff
+          * @param maxEdits number of word edits after which a line pair is
+          * reported as changed as a whole
+          * @return the changed line pairs; empty if file is not part of the diff
+          * @throws QGitException
+          */
+         QVector<QGitIntraLineDiff::LinePair> intraLineChanges(const QString &file,
+                 int maxEdits = QGitIntraLineDiff::DefaultMaxEdits) const;
+
          void diffCommits(QGitCommit commitFrom, QGitCommit commitTo);
 
+         /**
+          * @brief diffTrees Diffs two trees. Either tree may be null, in which case
+          * it is treated as empty (e.g. to diff a root commit).
+          * @param treeFrom the tree to diff from
+          * @param treeTo the tree to diff to
+          * @throws QGitException
+          */
+         void diffTrees(const QGitTree &treeFrom, const QGitTree &treeTo);
+
          bool diffWorkingDir();
 
+         /**
+          * @brief setSimilarityDetection Enables rename and copy detection for the
+          * following diffs. Detected pairs are reported as a single renamed or copied
+          * file instead of a deletion and an addition.
+          * @param flags what to look for; NoSimilarity turns detection off
+          * @param threshold similarity, in percent, two files need to be paired
+          * @param candidateLimit maximum number of candidates each file is compared
+          * against
+          */
+         void setSimilarityDetection(SimilarityFlags flags, int threshold = 50, int candidateLimit = 200);
+
+         /**
+          * @brief setPathSpec Limits the following diffs to the paths matching
+          * spec. Entries are either directory or file prefixes ("src/core") or
+          * fnmatch style globs ("*.cpp"). When the spec only holds prefixes, the
+          * subtrees are compared by oid first and unchanged ones are not opened.
+          * @param spec the paths to diff; an empty list diffs everything
+          */
+         void setPathSpec(const QStringList &spec);
+
+         QStringList pathSpec() const;
+
+         /**
+          * @brief setSimilarityCache Lets rename and copy detection reuse the blob
+          * signatures stored in cache instead of hashing every candidate again.
+          * The cache is not owned by the diff and must outlive it.
+          */
+         void setSimilarityCache(QGitSimilarityCache *cache);
+
+         /**
+          * @brief stream Walks the current diff and reports every file, hunk and
+          * line to the sink as views over libgit2's buffers. Nothing is copied or
+          * accumulated; use this instead of getDeltasForFile() when the patch text
+          * only needs to be looked at once.
+          * @param sink receiver of the callbacks
+          * @param detail how deep the walk goes; less detail is cheaper
+          * @return false if the sink stopped the iteration, true otherwise
+          * @throws QGitException
+          */
+         bool stream(QGitDiffSink *sink, StreamDetail detail = Lines) const;
+
+         /**
+          * @brief result Returns the files, line counts and patch text of the
+          * current diff in compact form. The result is built on the first call
+          * and shared by the QString based accessors afterwards.
+          * @return the diff result; empty if no diff has been made
+          * @throws QGitException
+          */
+         QGitDiffResult result();
+
          /**
           * @brief print This function returns a QString representation of
-          * 'git diff --patch'.
+          * 'git diff --patch'. The patch is decoded from UTF-8; use printRaw()
+          * when the exact bytes are needed.
           * @return A QString.
+          * @throws QGitException
           */
-         QString print();
+         QString print() const;
 
-         // public so they can be called from the c callback code
-         void addFileDiff(const char *delta);
-         void addFileChanged(const git_diff_delta *delta);
-         void addPatchHunks(const git_diff_delta *delta, const char *header, int headerLen);
-         void addPatchLines(const git_diff_delta *delta, const char *line, char usage, int lineLen);
-         void saveFullPatch(const char *line);
+         /**
+          * @brief printRaw Returns 'git diff --patch' as the bytes git produced,
+          * without any decoding. libgit2 formats the lines as C strings, so a
+          * line is cut at an embedded NUL; binary files only get their
+          * "Binary files differ" line.
+          * @return the patch; empty if no diff has been made
+          * @throws QGitException
+          */
+         QByteArray printRaw() const;
+
+         /**
+          * @brief stats Counts the insertions and deletions of every file of the
+          * current diff without generating any patch text.
+          * @return the stats; empty if no diff has been made
+          * @throws QGitException
+          */
+         QGitDiffStats stats() const;
 
          /**
           * @brief diffStats This function generates a string that is equivlent to running
-          * the command 'git diff --stats'. Makes the assumption that a diff has already occured
+          * the command 'git diff --stat'. Makes the assumption that a diff has already occured
           * before calling this function. If it has not then an empty string is returned.
+          * @param width number of columns the histogram is scaled to
           * @return A string containing diff stats.
           */
-         QString diffStats();
+         QString diffStats(int width = 80);
 
     private:
-         struct patchInfo
-         {
-             QString patch;
-             int additions;
-             int deletions;
-         };
+         /**
+          * Drops the current diff and everything that was collected from it.
+          */
+         void clear();
 
          /**
-          * @brief getDiffString helper function to print the +++--- for the diff stats
-          * @param additions number of '+' to put into the string
-          * @param deletions number of '-' to put into the string
-          * @return a string which contains '+' for each addition and a '-' for each
-          * deletion.
+          * Fills diffResult from the current diff, the first time
+          * one of the accessors needs it.
           */
-         QString getDiffString(int additions, int deletions);
+         void collectPatches();
 
-         QStringList fileList;
-         // Maps filename to patch hunk
-         QMap<QString, patchInfo> deltas;
+         /**
+          * Runs rename and copy detection on the current diff, if enabled.
+          */
+         void findSimilar();
+
+         /**
+          * Diff options matching the current settings.
+          */
+         git_diff_options options() const;
+
+         /**
+          * Return true if no entry of the path spec contains a glob.
+          */
+         bool pathSpecIsPrefixOnly() const;
+
+         // Files, counts and patch text of the current diff
+         QGitDiffResult diffResult;
          // Repo that contains the commits
          QGitRepository _repo;
          git_diff_list *diff;
-         QString patch;
+         bool patchesCollected;
+         SimilarityFlags similarityFlags;
+         int similarityThreshold;
+         int similarityCandidates;
+         QGitSimilarityCache *similarityCache;
+         // path spec entries and the pointers handed to libgit2
+         QList<QByteArray> pathSpecBytes;
+         QVector<char*> pathSpecStrings;
 
     };
+
+    Q_DECLARE_OPERATORS_FOR_FLAGS(QGitDiff::SimilarityFlags)
 }
 #endif // QGITDIFF_H
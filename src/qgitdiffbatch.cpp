@@ -0,0 +1,287 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitdiffbatch.h"
+
+#include "qgitdiff.h"
+#include "qgitcommit.h"
+#include "qgittree.h"
+#include "qgitrepository.h"
+#include "qgitrevwalk.h"
+#include "qgitexception.h"
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRunnable>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+
+#include <git2/errors.h>
+#include <git2/repository.h>
+
+namespace LibQGit2
+{
+
+/**
+ * Shared between the batch and its workers; everything but the atomic
+ * counter is protected by the mutex.
+ */
+class QGitDiffBatchState
+{
+public:
+    QGitDiffBatchState()
+        : nextPair(0), nextInOrder(0), deliveredCount(0), finishedEmitted(true)
+    {
+    }
+
+    QMutex mutex;
+    QList<QGitDiffBatch::CommitPair> pairs;
+    QAtomicInt nextPair;
+
+    QVector<QGitDiffResult> results;
+    QVector<QString> errors;
+    QVector<bool> done;
+    QList<int> completed;       // done and not delivered yet, as they finished
+    int nextInOrder;
+    int deliveredCount;
+    bool finishedEmitted;
+};
+
+namespace
+{
+
+class QGitDiffBatchWorker : public QRunnable
+{
+public:
+    QGitDiffBatchWorker(QGitDiffBatchState *state, QObject *batch,
+                        const QString &path, bool keepPatch)
+        : m_state(state), m_batch(batch), m_path(path), m_keepPatch(keepPatch)
+    {
+    }
+
+    void run()
+    {
+        git_repository *raw = 0;
+        int openError = git_repository_open(&raw, QFile::encodeName(m_path));
+        QGitRepository repo(raw, true);
+
+        int count = m_state->pairs.size();
+        int i;
+        while ((i = m_state->nextPair.fetchAndAddOrdered(1)) < count)
+        {
+            QGitDiffResult result;
+            QString error;
+
+            if (openError < 0)
+            {
+                const git_error *err = giterr_last();
+                error = err ? QString::fromUtf8(err->message) : QString("could not open repository");
+            }
+            else
+            {
+                try
+                {
+                    result = diffPair(repo, m_state->pairs.at(i));
+                }
+                catch (const QGitException &e)
+                {
+                    error = QString::fromUtf8(e.message());
+                }
+            }
+
+            {
+                QMutexLocker lock(&m_state->mutex);
+                m_state->results[i] = result;
+                m_state->errors[i] = error;
+                m_state->done[i] = true;
+                m_state->completed.append(i);
+            }
+            QMetaObject::invokeMethod(m_batch, "deliver", Qt::QueuedConnection);
+        }
+    }
+
+private:
+    QGitDiffResult diffPair(const QGitRepository &repo, const QGitDiffBatch::CommitPair &pair)
+    {
+        QGitTree from;
+        if (pair.first.isValid())
+        {
+            from = repo.lookupCommit(pair.first).tree();
+        }
+        QGitTree to = repo.lookupCommit(pair.second).tree();
+
+        QGitDiff diff(repo);
+        diff.diffTrees(from, to);
+
+        QGitDiffResultBuilder builder(m_keepPatch);
+        diff.stream(&builder);
+        return builder.result();
+    }
+
+    QGitDiffBatchState *m_state;
+    QObject *m_batch;
+    QString m_path;
+    bool m_keepPatch;
+};
+
+}
+
+QGitDiffBatch::QGitDiffBatch(const QGitRepository& repository, QObject *parent)
+    : QObject(parent)
+    , m_path(repository.path())
+    , m_order(InOrder)
+    , m_keepPatch(true)
+    , m_state(new QGitDiffBatchState)
+{
+    qRegisterMetaType<LibQGit2::QGitDiffResult>();
+}
+
+QGitDiffBatch::~QGitDiffBatch()
+{
+    m_pool.waitForDone();
+    delete m_state;
+}
+
+void QGitDiffBatch::setMaxThreads(int count)
+{
+    m_pool.setMaxThreadCount(count);
+}
+
+void QGitDiffBatch::setOrder(Order order)
+{
+    m_order = order;
+}
+
+void QGitDiffBatch::setKeepPatch(bool keep)
+{
+    m_keepPatch = keep;
+}
+
+QList<QGitDiffBatch::CommitPair> QGitDiffBatch::pairsFromWalk(QGitRevWalk& walk)
+{
+    QList<CommitPair> pairs;
+
+    QGitCommit commit;
+    while (walk.next(commit))
+    {
+        QGitOId parent;
+        if (commit.parentCount() > 0)
+        {
+            parent = commit.parentId(0);
+        }
+        pairs.append(qMakePair(parent, commit.oid()));
+    }
+    return pairs;
+}
+
+void QGitDiffBatch::start(const QList<CommitPair>& pairs)
+{
+    m_pool.waitForDone();
+
+    int count = pairs.size();
+    m_state->pairs = pairs;
+    m_state->nextPair = 0;
+    m_state->results = QVector<QGitDiffResult>(count);
+    m_state->errors = QVector<QString>(count);
+    m_state->done = QVector<bool>(count, false);
+    m_state->completed.clear();
+    m_state->nextInOrder = 0;
+    m_state->deliveredCount = 0;
+    m_state->finishedEmitted = false;
+
+    if (count == 0)
+    {
+        deliver();
+        return;
+    }
+
+    int workers = qMin(count, m_pool.maxThreadCount());
+    for (int i = 0; i < workers; ++i)
+    {
+        m_pool.start(new QGitDiffBatchWorker(m_state, this, m_path, m_keepPatch));
+    }
+}
+
+void QGitDiffBatch::waitForFinished()
+{
+    m_pool.waitForDone();
+    deliver();
+}
+
+QList<QGitDiffResult> QGitDiffBatch::run(const QList<CommitPair>& pairs)
+{
+    start(pairs);
+    waitForFinished();
+    return m_state->results.toList();
+}
+
+void QGitDiffBatch::deliver()
+{
+    QList<int> ready;
+    bool allDelivered = false;
+
+    {
+        QMutexLocker lock(&m_state->mutex);
+        int count = m_state->done.size();
+
+        if (m_order == InOrder)
+        {
+            while (m_state->nextInOrder < count && m_state->done.at(m_state->nextInOrder))
+            {
+                ready.append(m_state->nextInOrder++);
+            }
+        }
+        else
+        {
+            ready = m_state->completed;
+        }
+        m_state->completed.clear();
+
+        m_state->deliveredCount += ready.size();
+
+        if (!m_state->finishedEmitted && m_state->deliveredCount == count)
+        {
+            m_state->finishedEmitted = true;
+            allDelivered = true;
+        }
+    }
+
+    // results are no longer written to once they are done, so they can be
+    // read without holding the lock
+    foreach (int i, ready)
+    {
+        if (m_state->errors.at(i).isEmpty())
+        {
+            emit resultReady(i, m_state->results.at(i));
+        }
+        else
+        {
+            emit failed(i, m_state->errors.at(i));
+        }
+    }
+
+    if (allDelivered)
+    {
+        emit finished();
+    }
+}
+
+} // namespace LibQGit2
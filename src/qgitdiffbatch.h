@@ -0,0 +1,135 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_DIFFBATCH_H
+#define LIBQGIT2_DIFFBATCH_H
+
+#include "../libqgit2_export.h"
+
+#include "qgitdiffresult.h"
+#include "qgitoid.h"
+
+#include <QtCore/QObject>
+#include <QtCore/QList>
+#include <QtCore/QPair>
+#include <QtCore/QMetaType>
+#include <QtCore/QThreadPool>
+
+namespace LibQGit2
+{
+    class QGitRepository;
+    class QGitRevWalk;
+    class QGitDiffBatchState;
+
+    /**
+     * @brief Diffs many commit pairs on a pool of worker threads.
+     *
+     * Every worker opens its own handle on the repository, so the diffs do not
+     * contend on a single git_repository. libgit2 must be built thread safe and
+     * git_threads_init() must have been called.
+     *
+     * Results are emitted from the thread that owns the batch, either in the
+     * order of the input pairs or as soon as they complete.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_DIFF_EXPORT QGitDiffBatch : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        /**
+         * The (from, to) commits of one diff. A null `from` oid diffs against
+         * the empty tree.
+         */
+        typedef QPair<QGitOId, QGitOId> CommitPair;
+
+        enum Order
+        {
+            InOrder,        //!< resultReady() follows the order of the input pairs
+            AsCompleted     //!< resultReady() is emitted as soon as a diff is done
+        };
+
+        explicit QGitDiffBatch(const QGitRepository& repository, QObject *parent = 0);
+        ~QGitDiffBatch();
+
+        /**
+         * Number of worker threads; defaults to QThread::idealThreadCount().
+         */
+        void setMaxThreads(int count);
+
+        void setOrder(Order order);
+
+        /**
+         * If false, results only hold files and line counts, no patch text.
+         * Defaults to true.
+         */
+        void setKeepPatch(bool keep);
+
+        /**
+         * Build the pairs (first parent, commit) for every commit the walker
+         * yields. Root commits are paired with a null oid.
+         *
+         * @throws QGitException
+         */
+        static QList<CommitPair> pairsFromWalk(QGitRevWalk& walk);
+
+        /**
+         * Start diffing the pairs in the background. Results are delivered through
+         * resultReady() and failed(); finished() is emitted once all are delivered.
+         * The batch must not be started again before it has finished.
+         */
+        void start(const QList<CommitPair>& pairs);
+
+        /**
+         * Block until all the diffs of the current batch are done, and deliver
+         * the remaining signals.
+         */
+        void waitForFinished();
+
+        /**
+         * Convenience function: diff the pairs and block until all are done.
+         * @return the results in the order of the input pairs; failed diffs
+         * give an empty result
+         */
+        QList<QGitDiffResult> run(const QList<CommitPair>& pairs);
+
+    signals:
+        void resultReady(int index, const LibQGit2::QGitDiffResult& result);
+        void failed(int index, const QString& message);
+        void finished();
+
+    private slots:
+        void deliver();
+
+    private:
+        QString m_path;
+        Order m_order;
+        bool m_keepPatch;
+        QThreadPool m_pool;
+        QGitDiffBatchState *m_state;
+    };
+
+    /**@}*/
+}
+
+Q_DECLARE_METATYPE(LibQGit2::QGitDiffResult)
+
+#endif // LIBQGIT2_DIFFBATCH_H
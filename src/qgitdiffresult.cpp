@@ -0,0 +1,340 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitdiffresult.h"
+
+#include "qgitoid.h"
+
+#include <QtCore/QVector>
+
+#include <string.h>
+
+namespace LibQGit2
+{
+
+namespace
+{
+
+enum RecordFlag
+{
+    BinaryFlag = 0x1
+};
+
+/**
+ * One file of the diff. Paths and patch text are offsets into the arena.
+ */
+struct QGitDiffRecord
+{
+    git_oid oldOid;
+    git_oid newOid;
+    quint32 path;
+    quint32 oldPath;
+    quint32 patchBegin;
+    quint32 patchEnd;
+    quint16 pathLength;
+    quint16 oldPathLength;
+    quint8 status;
+    quint8 flags;
+    qint32 additions;
+    qint32 deletions;
+};
+
+uint hashBytes(const char *data, int len)
+{
+    // FNV-1a
+    uint h = 2166136261u;
+    for (int i = 0; i < len; ++i)
+    {
+        h ^= uchar(data[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+}
+
+class QGitDiffResultData : public QSharedData
+{
+public:
+    QGitDiffResultData()
+        : totalAdditions(0), totalDeletions(0)
+    {
+    }
+
+    QByteArray bytes(quint32 offset, int length) const
+    {
+        return QByteArray::fromRawData(arena.constData() + offset, length);
+    }
+
+    void buildIndex()
+    {
+        int size = 8;
+        while (size < records.size() * 2)
+        {
+            size <<= 1;
+        }
+
+        index.fill(-1, size);
+        for (int i = 0; i < records.size(); ++i)
+        {
+            const QGitDiffRecord &r = records.at(i);
+            uint slot = hashBytes(arena.constData() + r.path, r.pathLength) & (size - 1);
+            while (index.at(slot) != -1)
+            {
+                slot = (slot + 1) & (size - 1);
+            }
+            index[slot] = i;
+        }
+    }
+
+    QByteArray arena;
+    QVector<QGitDiffRecord> records;
+    // open addressing table of record indexes, -1 for empty slots
+    QVector<int> index;
+    int totalAdditions;
+    int totalDeletions;
+};
+
+QGitDiffResult::QGitDiffResult()
+    : d(new QGitDiffResultData)
+{
+}
+
+QGitDiffResult::QGitDiffResult(const QGitDiffResult& other)
+    : d(other.d)
+{
+}
+
+QGitDiffResult::~QGitDiffResult()
+{
+}
+
+QGitDiffResult& QGitDiffResult::operator=(const QGitDiffResult& other)
+{
+    d = other.d;
+    return *this;
+}
+
+int QGitDiffResult::fileCount() const
+{
+    return d->records.size();
+}
+
+int QGitDiffResult::indexOf(const QByteArray& path) const
+{
+    const QVector<int> &index = d->index;
+    if (index.isEmpty())
+    {
+        return -1;
+    }
+
+    int mask = index.size() - 1;
+    uint slot = hashBytes(path.constData(), path.size()) & mask;
+    while (index.at(slot) != -1)
+    {
+        const QGitDiffRecord &r = d->records.at(index.at(slot));
+        if (r.pathLength == path.size() &&
+            memcmp(d->arena.constData() + r.path, path.constData(), path.size()) == 0)
+        {
+            return index.at(slot);
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+QByteArray QGitDiffResult::path(int i) const
+{
+    const QGitDiffRecord &r = d->records.at(i);
+    return d->bytes(r.path, r.pathLength);
+}
+
+QByteArray QGitDiffResult::oldPath(int i) const
+{
+    const QGitDiffRecord &r = d->records.at(i);
+    return d->bytes(r.oldPath, r.oldPathLength);
+}
+
+git_delta_t QGitDiffResult::status(int i) const
+{
+    return git_delta_t(d->records.at(i).status);
+}
+
+QGitOId QGitDiffResult::oldOId(int i) const
+{
+    return QGitOId(&d->records.at(i).oldOid);
+}
+
+QGitOId QGitDiffResult::newOId(int i) const
+{
+    return QGitOId(&d->records.at(i).newOid);
+}
+
+int QGitDiffResult::additions(int i) const
+{
+    return d->records.at(i).additions;
+}
+
+int QGitDiffResult::deletions(int i) const
+{
+    return d->records.at(i).deletions;
+}
+
+bool QGitDiffResult::isBinary(int i) const
+{
+    return (d->records.at(i).flags & BinaryFlag) != 0;
+}
+
+QByteArray QGitDiffResult::patch(int i) const
+{
+    const QGitDiffRecord &r = d->records.at(i);
+    return d->bytes(r.patchBegin, r.patchEnd - r.patchBegin);
+}
+
+int QGitDiffResult::totalAdditions() const
+{
+    return d->totalAdditions;
+}
+
+int QGitDiffResult::totalDeletions() const
+{
+    return d->totalDeletions;
+}
+
+int QGitDiffResult::byteSize() const
+{
+    return sizeof(QGitDiffResultData)
+            + d->arena.capacity()
+            + d->records.capacity() * int(sizeof(QGitDiffRecord))
+            + d->index.capacity() * int(sizeof(int));
+}
+
+QGitDiffResultBuilder::QGitDiffResultBuilder(bool keepPatch)
+    : m_keepPatch(keepPatch)
+{
+}
+
+QGitDiffResultBuilder::~QGitDiffResultBuilder()
+{
+}
+
+bool QGitDiffResultBuilder::file(const QGitDiffFileView& file, float)
+{
+    closeFile();
+
+    QGitDiffResultData *data = m_result.d.data();
+    const git_diff_delta *delta = file.data();
+
+    QGitDiffRecord r;
+    git_oid_cpy(&r.oldOid, &delta->old_file.oid);
+    git_oid_cpy(&r.newOid, &delta->new_file.oid);
+
+    int pathLength = int(strlen(delta->new_file.path));
+    r.path = data->arena.size();
+    r.pathLength = pathLength;
+    data->arena.append(delta->new_file.path, pathLength);
+
+    // intern the old path when it is the same as the new one
+    if (strcmp(delta->old_file.path, delta->new_file.path) == 0)
+    {
+        r.oldPath = r.path;
+        r.oldPathLength = r.pathLength;
+    }
+    else
+    {
+        int oldPathLength = int(strlen(delta->old_file.path));
+        r.oldPath = data->arena.size();
+        r.oldPathLength = oldPathLength;
+        data->arena.append(delta->old_file.path, oldPathLength);
+    }
+
+    r.status = quint8(delta->status);
+    r.flags = file.isBinary() ? BinaryFlag : 0;
+    r.additions = 0;
+    r.deletions = 0;
+    r.patchBegin = data->arena.size();
+    r.patchEnd = r.patchBegin;
+
+    data->records.append(r);
+    return true;
+}
+
+bool QGitDiffResultBuilder::hunk(const QGitDiffFileView&, const QGitDiffHunkView& hunk)
+{
+    if (m_keepPatch)
+    {
+        QByteArray header = hunk.header();
+        m_result.d->arena.append(header.constData(), header.size());
+    }
+    return true;
+}
+
+bool QGitDiffResultBuilder::line(const QGitDiffFileView&, const QGitDiffHunkView&,
+                                 const QGitDiffLineView& line)
+{
+    QGitDiffResultData *data = m_result.d.data();
+    QGitDiffRecord &r = data->records.last();
+
+    char usage = line.origin();
+    if (usage == GIT_DIFF_LINE_ADDITION)
+    {
+        r.additions++;
+    }
+    else if (usage == GIT_DIFF_LINE_DELETION)
+    {
+        r.deletions++;
+    }
+
+    if (m_keepPatch)
+    {
+        data->arena.append(usage);
+        data->arena.append(line.constData(), line.length());
+    }
+    return true;
+}
+
+void QGitDiffResultBuilder::closeFile()
+{
+    QGitDiffResultData *data = m_result.d.data();
+    if (data->records.isEmpty())
+    {
+        return;
+    }
+
+    QGitDiffRecord &r = data->records.last();
+    r.patchEnd = data->arena.size();
+    data->totalAdditions += r.additions;
+    data->totalDeletions += r.deletions;
+}
+
+QGitDiffResult QGitDiffResultBuilder::result()
+{
+    closeFile();
+
+    QGitDiffResultData *data = m_result.d.data();
+    data->arena.squeeze();
+    data->records.squeeze();
+    data->buildIndex();
+
+    QGitDiffResult result = m_result;
+    m_result = QGitDiffResult();
+    return result;
+}
+
+} // namespace LibQGit2
@@ -0,0 +1,155 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_DIFFRESULT_H
+#define LIBQGIT2_DIFFRESULT_H
+
+#include "../libqgit2_export.h"
+
+#include "qgitdiffsink.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QSharedDataPointer>
+
+#include <git2/diff.h>
+
+namespace LibQGit2
+{
+    class QGitOId;
+    class QGitDiffResultData;
+
+    /**
+     * @brief Compact, immutable result of a diff.
+     *
+     * All paths and patch text live in one byte arena; every file is described
+     * by a fixed size record pointing into it, and a hash index maps paths to
+     * records. Copies share the same data.
+     *
+     * Byte arrays returned by this class wrap the arena without copying and
+     * stay valid as long as a QGitDiffResult sharing the data is alive.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_DIFF_EXPORT QGitDiffResult
+    {
+        public:
+            QGitDiffResult();
+
+            QGitDiffResult(const QGitDiffResult& other);
+
+            ~QGitDiffResult();
+
+            QGitDiffResult& operator=(const QGitDiffResult& other);
+
+            /**
+             * Number of files in the diff.
+             */
+            int fileCount() const;
+
+            /**
+             * Find the record of the file with the given new path.
+             * @return the record index, or -1 if the file is not part of the diff
+             */
+            int indexOf(const QByteArray& path) const;
+
+            /**
+             * Path of the file on the new side of the diff.
+             */
+            QByteArray path(int i) const;
+
+            /**
+             * Path of the file on the old side of the diff. Shares its storage
+             * with path() when the file was not renamed.
+             */
+            QByteArray oldPath(int i) const;
+
+            git_delta_t status(int i) const;
+
+            QGitOId oldOId(int i) const;
+
+            QGitOId newOId(int i) const;
+
+            int additions(int i) const;
+
+            int deletions(int i) const;
+
+            /**
+             * Return true if libgit2 detected binary content for the file.
+             */
+            bool isBinary(int i) const;
+
+            /**
+             * Hunk headers and lines of the file, in 'git diff' format.
+             * Empty if the result was built without patch text.
+             */
+            QByteArray patch(int i) const;
+
+            int totalAdditions() const;
+
+            int totalDeletions() const;
+
+            /**
+             * Approximate number of heap bytes used by the result.
+             */
+            int byteSize() const;
+
+        private:
+            friend class QGitDiffResultBuilder;
+            QSharedDataPointer<QGitDiffResultData> d;
+    };
+
+    /**
+     * @brief QGitDiffSink that fills a QGitDiffResult.
+     *
+     * Pass it to QGitDiff::stream() with QGitDiff::Lines to get per-file line
+     * counts and patch text, or use QGitDiff::result() directly.
+     */
+    class LIBQGIT2_DIFF_EXPORT QGitDiffResultBuilder : public QGitDiffSink
+    {
+        public:
+            /**
+             * @param keepPatch if false only the counts are recorded and the
+             * patch text is dropped
+             */
+            explicit QGitDiffResultBuilder(bool keepPatch = true);
+
+            ~QGitDiffResultBuilder();
+
+            bool file(const QGitDiffFileView& file, float progress);
+            bool hunk(const QGitDiffFileView& file, const QGitDiffHunkView& hunk);
+            bool line(const QGitDiffFileView& file, const QGitDiffHunkView& hunk,
+                      const QGitDiffLineView& line);
+
+            /**
+             * Finish building, and hand out the result. The builder is empty afterwards.
+             */
+            QGitDiffResult result();
+
+        private:
+            void closeFile();
+
+            QGitDiffResult m_result;
+            bool m_keepPatch;
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_DIFFRESULT_H
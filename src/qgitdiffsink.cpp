@@ -0,0 +1,148 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitdiffsink.h"
+
+#include "qgitoid.h"
+
+#include <string.h>
+
+namespace LibQGit2
+{
+
+QGitDiffFileView::QGitDiffFileView(const git_diff_delta *delta)
+    : d(delta)
+{
+}
+
+QByteArray QGitDiffFileView::oldPath() const
+{
+    return QByteArray::fromRawData(d->old_file.path, int(strlen(d->old_file.path)));
+}
+
+QByteArray QGitDiffFileView::newPath() const
+{
+    return QByteArray::fromRawData(d->new_file.path, int(strlen(d->new_file.path)));
+}
+
+QGitOId QGitDiffFileView::oldOId() const
+{
+    return QGitOId(&d->old_file.oid);
+}
+
+QGitOId QGitDiffFileView::newOId() const
+{
+    return QGitOId(&d->new_file.oid);
+}
+
+git_delta_t QGitDiffFileView::status() const
+{
+    return d->status;
+}
+
+bool QGitDiffFileView::isBinary() const
+{
+    return (d->flags & GIT_DIFF_FLAG_BINARY) != 0;
+}
+
+const git_diff_delta* QGitDiffFileView::data() const
+{
+    return d;
+}
+
+QGitDiffHunkView::QGitDiffHunkView(const git_diff_range *range, const char *header, size_t headerLen)
+    : d(range), m_header(header), m_headerLen(int(headerLen))
+{
+}
+
+int QGitDiffHunkView::oldStart() const
+{
+    return d->old_start;
+}
+
+int QGitDiffHunkView::oldLines() const
+{
+    return d->old_lines;
+}
+
+int QGitDiffHunkView::newStart() const
+{
+    return d->new_start;
+}
+
+int QGitDiffHunkView::newLines() const
+{
+    return d->new_lines;
+}
+
+QByteArray QGitDiffHunkView::header() const
+{
+    return QByteArray::fromRawData(m_header, m_headerLen);
+}
+
+const git_diff_range* QGitDiffHunkView::data() const
+{
+    return d;
+}
+
+QGitDiffLineView::QGitDiffLineView(char origin, const char *content, size_t length)
+    : m_origin(origin), m_content(content), m_length(int(length))
+{
+}
+
+char QGitDiffLineView::origin() const
+{
+    return m_origin;
+}
+
+QByteArray QGitDiffLineView::content() const
+{
+    return QByteArray::fromRawData(m_content, m_length);
+}
+
+const char* QGitDiffLineView::constData() const
+{
+    return m_content;
+}
+
+int QGitDiffLineView::length() const
+{
+    return m_length;
+}
+
+QGitDiffSink::~QGitDiffSink()
+{
+}
+
+bool QGitDiffSink::file(const QGitDiffFileView&, float)
+{
+    return true;
+}
+
+bool QGitDiffSink::hunk(const QGitDiffFileView&, const QGitDiffHunkView&)
+{
+    return true;
+}
+
+bool QGitDiffSink::line(const QGitDiffFileView&, const QGitDiffHunkView&, const QGitDiffLineView&)
+{
+    return true;
+}
+
+} // namespace LibQGit2
@@ -0,0 +1,183 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_DIFFSINK_H
+#define LIBQGIT2_DIFFSINK_H
+
+#include "../libqgit2_export.h"
+
+#include <QtCore/QByteArray>
+
+#include <git2/diff.h>
+
+namespace LibQGit2
+{
+    class QGitOId;
+
+    /**
+     * @brief View of a single file delta handed out by QGitDiff::stream().
+     *
+     * The view does not copy anything; it points into the buffers owned by
+     * libgit2 and is only valid during the sink callback it was passed to.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_DIFF_EXPORT QGitDiffFileView
+    {
+        public:
+            explicit QGitDiffFileView(const git_diff_delta *delta = 0);
+
+            /**
+             * Path of the file on the old side of the diff, as stored by git:
+             * UTF-8 encoded, decode it with QString::fromUtf8(). The bytes are
+             * not copied.
+             */
+            QByteArray oldPath() const;
+
+            /**
+             * Path of the file on the new side of the diff, as stored by git:
+             * UTF-8 encoded, decode it with QString::fromUtf8(). The bytes are
+             * not copied.
+             */
+            QByteArray newPath() const;
+
+            /**
+             * Object id of the old side of the diff.
+             */
+            QGitOId oldOId() const;
+
+            /**
+             * Object id of the new side of the diff.
+             */
+            QGitOId newOId() const;
+
+            /**
+             * Kind of change (added, deleted, modified, ...) of the file.
+             */
+            git_delta_t status() const;
+
+            /**
+             * Return true if libgit2 detected binary content on either side.
+             */
+            bool isBinary() const;
+
+            const git_diff_delta* data() const;
+
+        private:
+            const git_diff_delta *d;
+    };
+
+    /**
+     * @brief View of a single hunk handed out by QGitDiff::stream().
+     *
+     * Only valid during the sink callback it was passed to.
+     */
+    class LIBQGIT2_DIFF_EXPORT QGitDiffHunkView
+    {
+        public:
+            explicit QGitDiffHunkView(const git_diff_range *range = 0,
+                                      const char *header = 0, size_t headerLen = 0);
+
+            int oldStart() const;
+            int oldLines() const;
+            int newStart() const;
+            int newLines() const;
+
+            /**
+             * The "@@ -a,b +c,d @@" header line of the hunk, without copying it.
+             * The header is empty when the view is passed to QGitDiffSink::line().
+             */
+            QByteArray header() const;
+
+            const git_diff_range* data() const;
+
+        private:
+            const git_diff_range *d;
+            const char *m_header;
+            int m_headerLen;
+    };
+
+    /**
+     * @brief View of a single patch line handed out by QGitDiff::stream().
+     *
+     * Only valid during the sink callback it was passed to.
+     */
+    class LIBQGIT2_DIFF_EXPORT QGitDiffLineView
+    {
+        public:
+            QGitDiffLineView(char origin, const char *content, size_t length);
+
+            /**
+             * One of the GIT_DIFF_LINE_* values, e.g. '+', '-' or ' '.
+             */
+            char origin() const;
+
+            /**
+             * The line content (including the trailing newline, if any)
+             * as a QByteArray wrapping libgit2's buffer.
+             */
+            QByteArray content() const;
+
+            /**
+             * Raw access to the line content, for callers that do not even
+             * want the QByteArray header to be allocated.
+             */
+            const char* constData() const;
+            int length() const;
+
+        private:
+            char m_origin;
+            const char *m_content;
+            int m_length;
+    };
+
+    /**
+     * @brief Receiver interface for QGitDiff::stream().
+     *
+     * Reimplement the callbacks you are interested in. Returning false from a
+     * callback stops the diff iteration.
+     */
+    class LIBQGIT2_DIFF_EXPORT QGitDiffSink
+    {
+        public:
+            virtual ~QGitDiffSink();
+
+            /**
+             * Called once for every file of the diff, before its hunks.
+             * @param progress value between 0 and 1 describing how far the diff has gone
+             */
+            virtual bool file(const QGitDiffFileView& file, float progress);
+
+            /**
+             * Called for every hunk of the current file, before its lines.
+             */
+            virtual bool hunk(const QGitDiffFileView& file, const QGitDiffHunkView& hunk);
+
+            /**
+             * Called for every line of the current hunk.
+             */
+            virtual bool line(const QGitDiffFileView& file, const QGitDiffHunkView& hunk,
+                              const QGitDiffLineView& line);
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_DIFFSINK_H
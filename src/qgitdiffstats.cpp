@@ -0,0 +1,235 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitdiffstats.h"
+
+#include "qgitexception.h"
+
+#include <QtCore/QFile>
+
+#include <git2/diff.h>
+
+namespace LibQGit2
+{
+
+namespace
+{
+
+// smallest number of columns the histogram is shrunk to before names are cut
+const int MinGraphWidth = 10;
+
+int scale(int value, int max, int width)
+{
+    if (value == 0 || max <= width)
+    {
+        return value;
+    }
+    return 1 + (value * (width - 1)) / max;
+}
+
+}
+
+QGitDiffStats::QGitDiffStats()
+    : m_totalAdditions(0), m_totalDeletions(0)
+{
+}
+
+QGitDiffStats QGitDiffStats::fromDiff(git_diff_list *diff)
+{
+    QGitDiffStats stats;
+    if (diff == NULL)
+    {
+        return stats;
+    }
+
+    size_t count = git_diff_num_deltas(diff);
+    stats.m_files.reserve(int(count));
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const git_diff_delta *delta = 0;
+        qGitThrow(git_diff_get_patch(NULL, &delta, diff, i));
+        if (delta->status == GIT_DELTA_UNMODIFIED)
+        {
+            // only there as copy sources
+            continue;
+        }
+
+        git_diff_patch *patch = 0;
+        qGitThrow(git_diff_get_patch(&patch, NULL, diff, i));
+
+        // libgit2 counts the lines itself, so none of them reaches us as text
+        size_t context = 0, additions = 0, deletions = 0;
+        if (patch != NULL)
+        {
+            git_diff_patch_line_stats(&context, &additions, &deletions, patch);
+        }
+
+        FileStat file;
+        file.path = QByteArray(delta->new_file.path);
+        file.additions = int(additions);
+        file.deletions = int(deletions);
+        file.binary = (delta->flags & GIT_DIFF_FLAG_BINARY) != 0;
+
+        stats.m_totalAdditions += file.additions;
+        stats.m_totalDeletions += file.deletions;
+        stats.m_files.append(file);
+
+        git_diff_patch_free(patch);
+    }
+
+    return stats;
+}
+
+int QGitDiffStats::fileCount() const
+{
+    return m_files.size();
+}
+
+QByteArray QGitDiffStats::path(int i) const
+{
+    return m_files.at(i).path;
+}
+
+int QGitDiffStats::additions(int i) const
+{
+    return m_files.at(i).additions;
+}
+
+int QGitDiffStats::deletions(int i) const
+{
+    return m_files.at(i).deletions;
+}
+
+bool QGitDiffStats::isBinary(int i) const
+{
+    return m_files.at(i).binary;
+}
+
+int QGitDiffStats::totalAdditions() const
+{
+    return m_totalAdditions;
+}
+
+int QGitDiffStats::totalDeletions() const
+{
+    return m_totalDeletions;
+}
+
+QString QGitDiffStats::format(int width) const
+{
+    QVector<QString> names(m_files.size());
+    int nameWidth = 0;
+    int maxChange = 0;
+
+    for (int i = 0; i < m_files.size(); ++i)
+    {
+        const FileStat &file = m_files.at(i);
+        names[i] = QFile::decodeName(file.path);
+        nameWidth = qMax(nameWidth, names.at(i).size());
+        if (!file.binary)
+        {
+            maxChange = qMax(maxChange, file.additions + file.deletions);
+        }
+    }
+
+    // wide enough for the largest count and for "Bin"
+    int countWidth = qMax(QString::number(maxChange).size(), 3);
+
+    // " name | count graph"
+    int graphWidth = width - nameWidth - countWidth - 5;
+    if (graphWidth < MinGraphWidth)
+    {
+        graphWidth = MinGraphWidth;
+        nameWidth = qMax(width - countWidth - 5 - graphWidth, MinGraphWidth);
+    }
+    graphWidth = qMin(graphWidth, maxChange);
+
+    QString out;
+    out.reserve(m_files.size() * width);
+
+    for (int i = 0; i < m_files.size(); ++i)
+    {
+        const FileStat &file = m_files.at(i);
+
+        QString name = names.at(i);
+        if (name.size() > nameWidth)
+        {
+            name = QLatin1String("...") + name.right(nameWidth - 3);
+        }
+
+        out += QLatin1Char(' ');
+        out += name.leftJustified(nameWidth);
+        out += QLatin1String(" | ");
+
+        if (file.binary)
+        {
+            out += QLatin1String("Bin");
+        }
+        else
+        {
+            int total = file.additions + file.deletions;
+            out += QString::number(total).rightJustified(countWidth);
+
+            if (total > 0)
+            {
+                int scaledTotal = scale(total, maxChange, graphWidth);
+                int plus = qMin(scale(file.additions, maxChange, graphWidth), scaledTotal);
+                int minus = scaledTotal - plus;
+
+                // never hide one side completely; a single column goes to
+                // the larger side
+                if (file.deletions > 0 && minus == 0)
+                {
+                    if (scaledTotal > 1)
+                    {
+                        minus = 1;
+                        plus = scaledTotal - 1;
+                    }
+                    else if (file.deletions > file.additions)
+                    {
+                        minus = 1;
+                        plus = 0;
+                    }
+                }
+
+                out += QLatin1Char(' ');
+                out += QString(plus, QLatin1Char('+'));
+                out += QString(minus, QLatin1Char('-'));
+            }
+        }
+        out += QLatin1Char('\n');
+    }
+
+    int files = m_files.size();
+    out += QString(" %1 file%2 changed").arg(files).arg(files == 1 ? "" : "s");
+    if (m_totalAdditions != 0 || m_totalDeletions == 0)
+    {
+        out += QString(", %1 insertion%2(+)").arg(m_totalAdditions).arg(m_totalAdditions == 1 ? "" : "s");
+    }
+    if (m_totalDeletions != 0 || m_totalAdditions == 0)
+    {
+        out += QString(", %1 deletion%2(-)").arg(m_totalDeletions).arg(m_totalDeletions == 1 ? "" : "s");
+    }
+    out += QLatin1Char('\n');
+
+    return out;
+}
+
+} // namespace LibQGit2
@@ -0,0 +1,98 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_DIFFSTATS_H
+#define LIBQGIT2_DIFFSTATS_H
+
+#include "../libqgit2_export.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+struct git_diff_list;
+
+namespace LibQGit2
+{
+    /**
+     * @brief Numeric summary of a diff, like 'git diff --stat'.
+     *
+     * Only the insertion and deletion counts are computed; no patch text
+     * is generated or converted to build it.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_DIFF_EXPORT QGitDiffStats
+    {
+        public:
+            QGitDiffStats();
+
+            /**
+             * Count the changes of every file of the diff.
+             *
+             * @throws QGitException
+             */
+            static QGitDiffStats fromDiff(git_diff_list *diff);
+
+            int fileCount() const;
+
+            /**
+             * Path of the file on the new side of the diff, as stored by git.
+             */
+            QByteArray path(int i) const;
+
+            int additions(int i) const;
+
+            int deletions(int i) const;
+
+            /**
+             * Return true if the file is binary; binary files have no line counts.
+             */
+            bool isBinary(int i) const;
+
+            int totalAdditions() const;
+
+            int totalDeletions() const;
+
+            /**
+             * Render the stats the way 'git diff --stat' does: one line per file
+             * with a +/- histogram scaled so every line fits in `width` columns,
+             * followed by a summary line.
+             */
+            QString format(int width = 80) const;
+
+        private:
+            struct FileStat
+            {
+                QByteArray path;
+                int additions;
+                int deletions;
+                bool binary;
+            };
+
+            QVector<FileStat> m_files;
+            int m_totalAdditions;
+            int m_totalDeletions;
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_DIFFSTATS_H
@@ -0,0 +1,433 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitintralinediff.h"
+
+#include "qgitexception.h"
+
+#include <QtCore/QVarLengthArray>
+
+#include <string.h>
+
+namespace LibQGit2
+{
+
+namespace
+{
+
+struct Token
+{
+    int offset;
+    int length;
+    quint32 hash;
+};
+
+typedef QVarLengthArray<Token, 64> TokenList;
+
+inline bool isWordChar(uchar c)
+{
+    // bytes of multi byte UTF-8 sequences are part of the word
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+            || c == '_' || c >= 0x80;
+}
+
+inline bool isSpace(uchar c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+/**
+ * Number of leading bytes a and b have in common, compared a machine word
+ * at a time.
+ */
+int commonPrefix(const char *a, const char *b, int n)
+{
+    int i = 0;
+    for (; i + int(sizeof(quint64)) <= n; i += int(sizeof(quint64)))
+    {
+        quint64 x, y;
+        memcpy(&x, a + i, sizeof(x));
+        memcpy(&y, b + i, sizeof(y));
+        if (x != y)
+        {
+            break;
+        }
+    }
+    while (i < n && a[i] == b[i])
+    {
+        ++i;
+    }
+    return i;
+}
+
+/**
+ * Number of trailing bytes the buffers a (ending at aEnd) and b (ending at
+ * bEnd) have in common, looking at no more than n bytes.
+ */
+int commonSuffix(const char *aEnd, const char *bEnd, int n)
+{
+    int i = 0;
+    for (; i + int(sizeof(quint64)) <= n; i += int(sizeof(quint64)))
+    {
+        quint64 x, y;
+        memcpy(&x, aEnd - i - sizeof(x), sizeof(x));
+        memcpy(&y, bEnd - i - sizeof(y), sizeof(y));
+        if (x != y)
+        {
+            break;
+        }
+    }
+    while (i < n && aEnd[-i - 1] == bEnd[-i - 1])
+    {
+        ++i;
+    }
+    return i;
+}
+
+/**
+ * Split [begin, end) of line into words, whitespace runs and single
+ * punctuation characters.
+ */
+void tokenize(const char *line, int begin, int end, TokenList& tokens)
+{
+    int i = begin;
+    while (i < end)
+    {
+        const uchar c = uchar(line[i]);
+        int j = i + 1;
+        if (isWordChar(c))
+        {
+            while (j < end && isWordChar(uchar(line[j])))
+            {
+                ++j;
+            }
+        }
+        else if (isSpace(c))
+        {
+            while (j < end && isSpace(uchar(line[j])))
+            {
+                ++j;
+            }
+        }
+
+        Token t;
+        t.offset = i;
+        t.length = j - i;
+        t.hash = 2166136261u;
+        for (int k = i; k < j; ++k)
+        {
+            t.hash ^= uchar(line[k]);
+            t.hash *= 16777619u;
+        }
+        tokens.append(t);
+        i = j;
+    }
+}
+
+inline bool sameToken(const char *a, const Token& ta, const char *b, const Token& tb)
+{
+    return ta.hash == tb.hash && ta.length == tb.length
+            && memcmp(a + ta.offset, b + tb.offset, ta.length) == 0;
+}
+
+/**
+ * Turn the changed tokens into spans, merging neighbours.
+ */
+void appendSpans(const TokenList& tokens, const QVarLengthArray<bool, 64>& changed,
+                 QVector<QGitIntraLineDiff::Span>& spans)
+{
+    for (int i = 0; i < tokens.size(); ++i)
+    {
+        if (!changed[i])
+        {
+            continue;
+        }
+
+        const Token &t = tokens[i];
+        if (!spans.isEmpty() && spans.last().offset + spans.last().length == t.offset)
+        {
+            spans.last().length += t.length;
+        }
+        else
+        {
+            QGitIntraLineDiff::Span span;
+            span.offset = t.offset;
+            span.length = t.length;
+            spans.append(span);
+        }
+    }
+}
+
+/**
+ * Myers' O(ND) difference algorithm on two token lists, giving up after
+ * maxEdits edits. Marks the deleted and inserted tokens.
+ */
+bool myers(const char *a, const TokenList& ta, const char *b, const TokenList& tb, int maxEdits,
+           QVarLengthArray<bool, 64>& deleted, QVarLengthArray<bool, 64>& inserted)
+{
+    const int n = ta.size();
+    const int m = tb.size();
+    const int max = qMin(n + m, maxEdits);
+    const int offset = max + 1;
+    const int width = 2 * max + 3;
+
+    // furthest reaching x for every diagonal k, one row per edit count
+    QVector<int> trace;
+    QVarLengthArray<int, 256> v(width);
+    memset(v.data(), 0, width * sizeof(int));
+
+    int found = -1;
+    for (int d = 0; d <= max && found < 0; ++d)
+    {
+        for (int k = -d; k <= d; k += 2)
+        {
+            int x;
+            if (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1]))
+            {
+                x = v[offset + k + 1];
+            }
+            else
+            {
+                x = v[offset + k - 1] + 1;
+            }
+
+            int y = x - k;
+            while (x < n && y < m && sameToken(a, ta[x], b, tb[y]))
+            {
+                ++x;
+                ++y;
+            }
+            v[offset + k] = x;
+
+            if (x >= n && y >= m)
+            {
+                found = d;
+                break;
+            }
+        }
+        int row = trace.size();
+        trace.resize(row + width);
+        memcpy(trace.data() + row, v.constData(), width * sizeof(int));
+    }
+
+    if (found < 0)
+    {
+        return false;
+    }
+
+    int x = n;
+    int y = m;
+    for (int d = found; d > 0; --d)
+    {
+        const int *prev = trace.constData() + (d - 1) * width;
+        const int k = x - y;
+
+        int prevK;
+        if (k == -d || (k != d && prev[offset + k - 1] < prev[offset + k + 1]))
+        {
+            prevK = k + 1;
+        }
+        else
+        {
+            prevK = k - 1;
+        }
+
+        const int prevX = prev[offset + prevK];
+        const int prevY = prevX - prevK;
+
+        if (prevK == k + 1)
+        {
+            inserted[prevY] = true;
+        }
+        else
+        {
+            deleted[prevX] = true;
+        }
+
+        x = prevX;
+        y = prevY;
+    }
+
+    return true;
+}
+
+}
+
+bool QGitIntraLineDiff::compare(const char *oldLine, int oldLength,
+                                const char *newLine, int newLength,
+                                QVector<Span>& oldSpans, QVector<Span>& newSpans,
+                                int maxEdits)
+{
+    oldSpans.clear();
+    newSpans.clear();
+
+    if (oldLength > 0 && oldLine[oldLength - 1] == '\n')
+    {
+        --oldLength;
+    }
+    if (newLength > 0 && newLine[newLength - 1] == '\n')
+    {
+        --newLength;
+    }
+
+    // cut the common head and tail, but never in the middle of a word
+    int prefix = commonPrefix(oldLine, newLine, qMin(oldLength, newLength));
+    if ((prefix < oldLength && isWordChar(uchar(oldLine[prefix])))
+            || (prefix < newLength && isWordChar(uchar(newLine[prefix]))))
+    {
+        while (prefix > 0 && isWordChar(uchar(oldLine[prefix - 1])))
+        {
+            --prefix;
+        }
+    }
+
+    int suffix = commonSuffix(oldLine + oldLength, newLine + newLength,
+                              qMin(oldLength, newLength) - prefix);
+    if (suffix > 0)
+    {
+        const int oldEnd = oldLength - suffix;
+        const int newEnd = newLength - suffix;
+        if ((oldEnd > prefix && isWordChar(uchar(oldLine[oldEnd - 1])))
+                || (newEnd > prefix && isWordChar(uchar(newLine[newEnd - 1]))))
+        {
+            while (suffix > 0 && isWordChar(uchar(oldLine[oldLength - suffix])))
+            {
+                --suffix;
+            }
+        }
+    }
+
+    const int oldEnd = oldLength - suffix;
+    const int newEnd = newLength - suffix;
+
+    TokenList oldTokens, newTokens;
+    tokenize(oldLine, prefix, oldEnd, oldTokens);
+    tokenize(newLine, prefix, newEnd, newTokens);
+
+    QVarLengthArray<bool, 64> deleted(oldTokens.size());
+    QVarLengthArray<bool, 64> inserted(newTokens.size());
+    memset(deleted.data(), 0, deleted.size());
+    memset(inserted.data(), 0, inserted.size());
+    bool exact = myers(oldLine, oldTokens, newLine, newTokens, maxEdits, deleted, inserted);
+
+    if (!exact)
+    {
+        // too different to be worth a finer answer
+        for (int i = 0; i < deleted.size(); ++i)
+        {
+            deleted[i] = true;
+        }
+        for (int i = 0; i < inserted.size(); ++i)
+        {
+            inserted[i] = true;
+        }
+    }
+
+    appendSpans(oldTokens, deleted, oldSpans);
+    appendSpans(newTokens, inserted, newSpans);
+    return exact;
+}
+
+bool QGitIntraLineDiff::compare(const QByteArray& oldLine, const QByteArray& newLine,
+                                QVector<Span>& oldSpans, QVector<Span>& newSpans,
+                                int maxEdits)
+{
+    return compare(oldLine.constData(), oldLine.size(), newLine.constData(), newLine.size(),
+                   oldSpans, newSpans, maxEdits);
+}
+
+QVector<QGitIntraLineDiff::LinePair> QGitIntraLineDiff::fromPatch(git_diff_patch *patch, int maxEdits)
+{
+    QVector<LinePair> pairs;
+    if (patch == NULL)
+    {
+        return pairs;
+    }
+
+    struct Line
+    {
+        const char *content;
+        size_t length;
+        int lineNo;
+    };
+
+    size_t hunks = git_diff_patch_num_hunks(patch);
+    for (size_t h = 0; h < hunks; ++h)
+    {
+        const git_diff_range *range = NULL;
+        size_t lines = 0;
+        qGitThrow(git_diff_patch_get_hunk(&range, NULL, NULL, &lines, patch, h));
+
+        QVarLengthArray<Line, 16> deletions;
+        QVarLengthArray<Line, 16> additions;
+
+        // one extra round flushes the last run of the hunk
+        for (size_t i = 0; i <= lines; ++i)
+        {
+            char origin = GIT_DIFF_LINE_CONTEXT;
+            Line line = { NULL, 0, 0 };
+            int oldLineNo = 0;
+            int newLineNo = 0;
+
+            if (i < lines)
+            {
+                qGitThrow(git_diff_patch_get_line_in_hunk(&origin, &line.content, &line.length,
+                                                          &oldLineNo, &newLineNo, patch, h, i));
+            }
+
+            if (origin == GIT_DIFF_LINE_DELETION && additions.isEmpty())
+            {
+                line.lineNo = oldLineNo;
+                deletions.append(line);
+                continue;
+            }
+            if (origin == GIT_DIFF_LINE_ADDITION && !deletions.isEmpty())
+            {
+                line.lineNo = newLineNo;
+                additions.append(line);
+                continue;
+            }
+
+            // end of a -/+ run: pair its lines in order
+            for (int j = 0; j < qMin(deletions.size(), additions.size()); ++j)
+            {
+                LinePair pair;
+                pair.hunk = int(h);
+                pair.oldLine = deletions[j].lineNo;
+                pair.newLine = additions[j].lineNo;
+                compare(deletions[j].content, int(deletions[j].length),
+                        additions[j].content, int(additions[j].length),
+                        pair.oldSpans, pair.newSpans, maxEdits);
+                pairs.append(pair);
+            }
+            deletions.clear();
+            additions.clear();
+
+            if (origin == GIT_DIFF_LINE_DELETION)
+            {
+                line.lineNo = oldLineNo;
+                deletions.append(line);
+            }
+        }
+    }
+
+    return pairs;
+}
+
+} // namespace LibQGit2
@@ -0,0 +1,98 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_INTRALINEDIFF_H
+#define LIBQGIT2_INTRALINEDIFF_H
+
+#include "../libqgit2_export.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+
+#include <git2/diff.h>
+
+namespace LibQGit2
+{
+    /**
+     * @brief Word level changes inside the modified lines of a patch.
+     *
+     * Within every hunk, a run of deleted lines directly followed by a run of
+     * added lines is paired up line by line. Each pair is split into words,
+     * whitespace runs and single punctuation characters, and the two token
+     * lists are compared with Myers' algorithm. The number of edits is bounded;
+     * pairs that differ more than that are reported as changed as a whole
+     * (minus their common prefix and suffix).
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_DIFF_EXPORT QGitIntraLineDiff
+    {
+        public:
+            enum { DefaultMaxEdits = 64 };
+
+            /**
+             * A changed range of a line, in bytes from the start of its content.
+             */
+            struct Span
+            {
+                int offset;
+                int length;
+            };
+
+            /**
+             * A deleted line and the added line that replaced it.
+             */
+            struct LinePair
+            {
+                int hunk;       //!< index of the hunk in the patch
+                int oldLine;    //!< line number in the old file
+                int newLine;    //!< line number in the new file
+                QVector<Span> oldSpans;
+                QVector<Span> newSpans;
+            };
+
+            /**
+             * Compare two lines word by word. A trailing newline is ignored.
+             *
+             * @param oldSpans receives the ranges of oldLine that were removed
+             * @param newSpans receives the ranges of newLine that were added
+             * @param maxEdits number of token edits after which the search gives up
+             * @return false if maxEdits was exceeded and the spans only cover the
+             * part between the common prefix and suffix
+             */
+            static bool compare(const char *oldLine, int oldLength,
+                                const char *newLine, int newLength,
+                                QVector<Span>& oldSpans, QVector<Span>& newSpans,
+                                int maxEdits = DefaultMaxEdits);
+
+            static bool compare(const QByteArray& oldLine, const QByteArray& newLine,
+                                QVector<Span>& oldSpans, QVector<Span>& newSpans,
+                                int maxEdits = DefaultMaxEdits);
+
+            /**
+             * Pair up the modified lines of every hunk of patch and compare them.
+             */
+            static QVector<LinePair> fromPatch(git_diff_patch *patch, int maxEdits = DefaultMaxEdits);
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_INTRALINEDIFF_H
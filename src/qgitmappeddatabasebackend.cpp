@@ -0,0 +1,541 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitmappeddatabasebackend.h"
+
+#include "qgitdatabase.h"
+#include "qgitexception.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QVector>
+#include <QtCore/QtEndian>
+
+#include <git2/errors.h>
+#include <git2/odb.h>
+
+#include <algorithm>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace LibQGit2
+{
+
+/*
+ * File layout, all numbers big endian:
+ *
+ *   "QODB", version, object count, reserved        4 x 4 bytes
+ *   fanout: number of objects whose first oid
+ *           byte is <= i, for i in 0..255          256 x 4 bytes
+ *   oids, sorted                                   count x 20 bytes
+ *   per object: payload offset (high, low),
+ *               payload length, size, type         count x 20 bytes
+ *   payloads
+ *
+ * A payload is the qCompress()ed object, or the object itself when
+ * compressing does not make it smaller; StoredFlag is then set in the type.
+ */
+
+extern "C" int mappedForeachCallBack(const git_oid *oid, void *payload);
+
+namespace
+{
+
+const char Magic[4] = { 'Q', 'O', 'D', 'B' };
+const quint32 Version = 1;
+const int HeaderSize = 16;
+const int FanoutSize = 256 * 4;
+const int OidSize = GIT_OID_RAWSZ;
+const int EntrySize = 20;
+
+const quint32 StoredFlag = 0x80000000u;
+const int NotFound = -1;
+
+// interpolation gives up on badly distributed ranges after this many probes
+const int MaxProbes = 8;
+// below this many ids, bisecting is as fast
+const int SmallRange = 16;
+
+inline quint32 readUInt32(const uchar *p)
+{
+    return qFromBigEndian<quint32>(p);
+}
+
+struct OdbObjectGuard
+{
+    OdbObjectGuard() : object(NULL) {}
+    ~OdbObjectGuard() { git_odb_object_free(object); }
+    git_odb_object *object;
+};
+
+/**
+ * Remove the lock file unless it was renamed into place, whatever made
+ * build() stop.
+ */
+struct LockFileGuard
+{
+    explicit LockFileGuard(QFile &f) : file(f), renamed(false) {}
+    ~LockFileGuard() { if (!renamed) file.remove(); }
+    QFile &file;
+    bool renamed;
+};
+
+struct OidLess
+{
+    bool operator()(const git_oid &a, const git_oid &b) const
+    {
+        return git_oid_cmp(&a, &b) < 0;
+    }
+};
+
+struct OidEqual
+{
+    bool operator()(const git_oid &a, const git_oid &b) const
+    {
+        return git_oid_equal(&a, &b);
+    }
+};
+
+struct Entry
+{
+    quint64 offset;
+    quint32 length;
+    quint32 size;
+    quint32 type;
+};
+
+void throwFileError(const char *message)
+{
+    giterr_set_str(GITERR_OS, message);
+    qGitThrow(GIT_ERROR);
+}
+
+}
+
+extern "C" int mappedForeachCallBack(const git_oid *oid, void *payload)
+{
+    static_cast<QVector<git_oid>*>(payload)->append(*oid);
+    return 0;
+}
+
+QGitMappedDatabaseBackend::QGitMappedDatabaseBackend()
+    : m_map(0)
+    , m_size(0)
+    , m_count(0)
+    , m_fanout(0)
+    , m_oids(0)
+    , m_entries(0)
+{
+}
+
+QGitMappedDatabaseBackend::~QGitMappedDatabaseBackend()
+{
+    close();
+}
+
+int QGitMappedDatabaseBackend::build(const QGitDatabase& source, const QString& filePath, int level)
+{
+    QVector<git_oid> oids;
+    qGitThrow(git_odb_foreach(source.data(), mappedForeachCallBack, &oids));
+
+    // an object stored loose and in a pack is listed twice
+    std::sort(oids.begin(), oids.end(), OidLess());
+    oids.erase(std::unique(oids.begin(), oids.end(), OidEqual()), oids.end());
+    const int count = oids.size();
+
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+    QFile file(filePath + QLatin1String(".lock"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        giterr_set_str(GITERR_OS, file.errorString().toLocal8Bit().constData());
+        qGitThrow(GIT_ERROR);
+    }
+    LockFileGuard lock(file);
+
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::BigEndian);
+    out.writeRawData(Magic, sizeof(Magic));
+    out << Version << quint32(count) << quint32(0);
+
+    int upTo = 0;
+    for (int b = 0; b < 256; ++b)
+    {
+        while (upTo < count && oids.at(upTo).id[0] <= b)
+        {
+            ++upTo;
+        }
+        out << quint32(upTo);
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        out.writeRawData(reinterpret_cast<const char*>(oids.at(i).id), OidSize);
+    }
+
+    // the entries are only known once the payloads are written
+    const qint64 entriesAt = file.pos();
+    out.writeRawData(QByteArray(count * EntrySize, '\0').constData(), count * EntrySize);
+
+    QVector<Entry> entries(count);
+    quint64 offset = quint64(entriesAt) + quint64(count) * EntrySize;
+    for (int i = 0; i < count; ++i)
+    {
+        OdbObjectGuard guard;
+        qGitThrow(git_odb_read(&guard.object, source.data(), &oids.at(i)));
+
+        const uchar *data = static_cast<const uchar*>(git_odb_object_data(guard.object));
+        const size_t size = git_odb_object_size(guard.object);
+        if (size > size_t(0x7fffffff))
+        {
+            throwFileError("object too large for the mapped object database");
+        }
+
+        Entry &entry = entries[i];
+        entry.offset = offset;
+        entry.size = quint32(size);
+        entry.type = quint32(git_odb_object_type(guard.object));
+
+        const QByteArray compressed = qCompress(data, int(size), level);
+        if (compressed.size() < int(size))
+        {
+            entry.length = quint32(compressed.size());
+            out.writeRawData(compressed.constData(), compressed.size());
+        }
+        else
+        {
+            entry.length = quint32(size);
+            entry.type |= StoredFlag;
+            out.writeRawData(reinterpret_cast<const char*>(data), int(size));
+        }
+        offset += entry.length;
+
+        if (out.status() != QDataStream::Ok)
+        {
+            throwFileError("failed to write the mapped object database");
+        }
+    }
+
+    if (!file.seek(entriesAt))
+    {
+        throwFileError("failed to write the mapped object database");
+    }
+    foreach (const Entry &entry, entries)
+    {
+        out << quint32(entry.offset >> 32) << quint32(entry.offset) << entry.length << entry.size
+            << entry.type;
+    }
+
+    file.close();
+    if (out.status() != QDataStream::Ok || file.error() != QFile::NoError)
+    {
+        throwFileError("failed to write the mapped object database");
+    }
+
+    // rename() swaps the files in one step: open() sees either the old one
+    // or the new one, and readers keep the old one mapped until they reopen
+    if (::rename(QFile::encodeName(file.fileName()).constData(), QFile::encodeName(filePath).constData()) != 0)
+    {
+        throwFileError("failed to replace the mapped object database");
+    }
+    lock.renamed = true;
+
+    return count;
+}
+
+bool QGitMappedDatabaseBackend::open(const QString& filePath)
+{
+    close();
+
+    m_file.setFileName(filePath);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    const qint64 size = m_file.size();
+    if (size < HeaderSize + FanoutSize || !(m_map = m_file.map(0, size)))
+    {
+        close();
+        return false;
+    }
+
+    if (memcmp(m_map, Magic, sizeof(Magic)) != 0 || readUInt32(m_map + 4) != Version)
+    {
+        close();
+        return false;
+    }
+
+    const qint64 count = readUInt32(m_map + 8);
+    if (HeaderSize + FanoutSize + count * (OidSize + EntrySize) > size
+        || readUInt32(m_map + HeaderSize + 255 * 4) != count)
+    {
+        close();
+        return false;
+    }
+
+    // find() and lowerBound() trust the fanout to stay inside the oid table
+    quint32 previous = 0;
+    for (int b = 0; b < 256; ++b)
+    {
+        const quint32 upTo = readUInt32(m_map + HeaderSize + b * 4);
+        if (upTo < previous || upTo > count)
+        {
+            close();
+            return false;
+        }
+        previous = upTo;
+    }
+
+    m_size = size;
+    m_count = int(count);
+    m_fanout = m_map + HeaderSize;
+    m_oids = m_fanout + FanoutSize;
+    m_entries = m_oids + count * OidSize;
+    return true;
+}
+
+void QGitMappedDatabaseBackend::close()
+{
+    if (m_map)
+    {
+        m_file.unmap(const_cast<uchar*>(m_map));
+    }
+    m_file.close();
+
+    m_map = 0;
+    m_size = 0;
+    m_count = 0;
+    m_fanout = m_oids = m_entries = 0;
+}
+
+bool QGitMappedDatabaseBackend::isOpen() const
+{
+    return m_map != 0;
+}
+
+int QGitMappedDatabaseBackend::count() const
+{
+    return m_count;
+}
+
+int QGitMappedDatabaseBackend::read(QByteArray& data, git_otype *type, const git_oid *oid)
+{
+    const int pos = find(oid);
+    if (pos == NotFound)
+    {
+        return GIT_ENOTFOUND;
+    }
+    return readEntry(pos, data, type);
+}
+
+int QGitMappedDatabaseBackend::readPrefix(git_oid *fullOid, QByteArray& data, git_otype *type,
+                                          const git_oid *shortOid, size_t length)
+{
+    if (length >= GIT_OID_HEXSZ)
+    {
+        git_oid_cpy(fullOid, shortOid);
+        return read(data, type, shortOid);
+    }
+
+    // the smallest id with the prefix: whatever follows it is zeroed
+    git_oid key;
+    memset(&key, 0, sizeof(key));
+    memcpy(key.id, shortOid->id, (length + 1) / 2);
+    if (length % 2)
+    {
+        key.id[length / 2] &= 0xf0;
+    }
+
+    const int pos = lowerBound(&key);
+    if (pos == m_count || git_oid_ncmp(oidAt(pos), shortOid, length) != 0)
+    {
+        return GIT_ENOTFOUND;
+    }
+    if (pos + 1 < m_count && git_oid_ncmp(oidAt(pos + 1), shortOid, length) == 0)
+    {
+        giterr_set_str(GITERR_ODB, "ambiguous object id prefix");
+        return GIT_EAMBIGUOUS;
+    }
+
+    git_oid_cpy(fullOid, oidAt(pos));
+    return readEntry(pos, data, type);
+}
+
+int QGitMappedDatabaseBackend::readHeader(size_t *size, git_otype *type, const git_oid *oid)
+{
+    const int pos = find(oid);
+    if (pos == NotFound)
+    {
+        return GIT_ENOTFOUND;
+    }
+
+    const uchar *entry = m_entries + pos * EntrySize;
+    *size = readUInt32(entry + 12);
+    *type = git_otype(readUInt32(entry + 16) & ~StoredFlag);
+    return 0;
+}
+
+int QGitMappedDatabaseBackend::write(const git_oid *oid, const void *data, size_t size, git_otype type)
+{
+    Q_UNUSED(oid);
+    Q_UNUSED(data);
+    Q_UNUSED(size);
+    Q_UNUSED(type);
+
+    giterr_set_str(GITERR_ODB, "the mapped object database is read-only");
+    return GIT_ERROR;
+}
+
+bool QGitMappedDatabaseBackend::exists(const git_oid *oid)
+{
+    return find(oid) != NotFound;
+}
+
+int QGitMappedDatabaseBackend::forEachObject(git_odb_foreach_cb callback, void *payload)
+{
+    for (int pos = 0; pos < m_count; ++pos)
+    {
+        const int err = callback(oidAt(pos), payload);
+        if (err != 0)
+        {
+            return err;
+        }
+    }
+    return 0;
+}
+
+const git_oid* QGitMappedDatabaseBackend::oidAt(int pos) const
+{
+    return reinterpret_cast<const git_oid*>(m_oids + pos * OidSize);
+}
+
+int QGitMappedDatabaseBackend::find(const git_oid *oid) const
+{
+    if (m_count == 0)
+    {
+        return NotFound;
+    }
+
+    const int first = oid->id[0];
+    int lo = first == 0 ? 0 : int(readUInt32(m_fanout + (first - 1) * 4));
+    int hi = int(readUInt32(m_fanout + first * 4));
+
+    // ids are evenly spread, so the next four bytes tell where to probe
+    const quint32 key = readUInt32(oid->id + 1);
+    for (int probes = 0; probes < MaxProbes && hi - lo > SmallRange; ++probes)
+    {
+        const quint32 low = readUInt32(m_oids + lo * OidSize + 1);
+        const quint32 high = readUInt32(m_oids + (hi - 1) * OidSize + 1);
+        if (key < low || key > high)
+        {
+            return NotFound;
+        }
+        if (low == high)
+        {
+            break;
+        }
+
+        const int probe = lo + int(quint64(key - low) * quint64(hi - 1 - lo) / (high - low));
+        const int cmp = memcmp(m_oids + probe * OidSize, oid->id, OidSize);
+        if (cmp == 0)
+        {
+            return probe;
+        }
+        if (cmp < 0)
+            lo = probe + 1;
+        else
+            hi = probe;
+    }
+
+    while (lo < hi)
+    {
+        const int mid = (lo + hi) / 2;
+        const int cmp = memcmp(m_oids + mid * OidSize, oid->id, OidSize);
+        if (cmp == 0)
+        {
+            return mid;
+        }
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return NotFound;
+}
+
+int QGitMappedDatabaseBackend::lowerBound(const git_oid *oid) const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+
+    // the end of the bucket is where the greater ids start
+    const int first = oid->id[0];
+    int lo = first == 0 ? 0 : int(readUInt32(m_fanout + (first - 1) * 4));
+    int hi = int(readUInt32(m_fanout + first * 4));
+    while (lo < hi)
+    {
+        const int mid = (lo + hi) / 2;
+        if (memcmp(m_oids + mid * OidSize, oid->id, OidSize) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+int QGitMappedDatabaseBackend::readEntry(int pos, QByteArray& data, git_otype *type) const
+{
+    const uchar *entry = m_entries + pos * EntrySize;
+    const quint64 offset = (quint64(readUInt32(entry)) << 32) | readUInt32(entry + 4);
+    const quint32 length = readUInt32(entry + 8);
+    const quint32 size = readUInt32(entry + 12);
+    const quint32 flags = readUInt32(entry + 16);
+
+    if (offset > quint64(m_size) || length > quint64(m_size) - offset)
+    {
+        giterr_set_str(GITERR_ODB, "corrupted mapped object database");
+        return GIT_ERROR;
+    }
+
+    const uchar *payload = m_map + offset;
+    if (flags & StoredFlag)
+    {
+        data = QByteArray(reinterpret_cast<const char*>(payload), int(length));
+    }
+    else
+    {
+        data = qUncompress(payload, int(length));
+    }
+
+    if (quint32(data.size()) != size)
+    {
+        giterr_set_str(GITERR_ODB, "corrupted mapped object database");
+        return GIT_ERROR;
+    }
+
+    *type = git_otype(flags & ~StoredFlag);
+    return 0;
+}
+
+} // namespace LibQGit2
@@ -0,0 +1,119 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_MAPPEDDATABASEBACKEND_H
+#define LIBQGIT2_MAPPEDDATABASEBACKEND_H
+
+#include "../libqgit2_export.h"
+
+#include "qgitdatabasebackend.h"
+
+#include <QtCore/QFile>
+
+namespace LibQGit2
+{
+    class QGitDatabase;
+
+    /**
+     * @brief Read-only object database backend stored in one memory mapped file.
+     *
+     * The file holds a fan-out table, the sorted ids of every object with
+     * the offset, type and size of each, and the zlib compressed objects.
+     * Looking an object up is a search in the mapped id table; no file is
+     * opened and no pack window is kept per object. Several processes
+     * mapping the same file share it through the page cache.
+     *
+     * The file is a snapshot written by build(); the backend never writes to
+     * it, so it suits read-only mirrors that are rebuilt from time to time.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_DATABASEBACKEND_EXPORT QGitMappedDatabaseBackend : public QGitDatabaseBackend
+    {
+        public:
+            QGitMappedDatabaseBackend();
+
+            ~QGitMappedDatabaseBackend();
+
+            /**
+             * Write every object of source to filePath. The file is written
+             * next to it and renamed over it, which replaces it in one step on
+             * POSIX systems.
+             * @param level the zlib compression level, -1 for the default
+             * @return the number of objects written
+             * @throws QGitException
+             */
+            static int build(const QGitDatabase& source, const QString& filePath, int level = -1);
+
+            /**
+             * Map filePath.
+             * @return false if the file can not be read or is not valid
+             */
+            bool open(const QString& filePath);
+
+            void close();
+
+            bool isOpen() const;
+
+            /**
+             * Number of objects in the file.
+             */
+            int count() const;
+
+            int read(QByteArray& data, git_otype *type, const git_oid *oid);
+
+            int readPrefix(git_oid *fullOid, QByteArray& data, git_otype *type,
+                           const git_oid *shortOid, size_t length);
+
+            /**
+             * Read the size and type of an object without inflating it.
+             */
+            int readHeader(size_t *size, git_otype *type, const git_oid *oid);
+
+            /**
+             * Always fails, the file is immutable.
+             */
+            int write(const git_oid *oid, const void *data, size_t size, git_otype type);
+
+            bool exists(const git_oid *oid);
+
+            int forEachObject(git_odb_foreach_cb callback, void *payload);
+
+        private:
+            const git_oid* oidAt(int pos) const;
+            int find(const git_oid *oid) const;
+            int lowerBound(const git_oid *oid) const;
+            int readEntry(int pos, QByteArray& data, git_otype *type) const;
+
+            QFile m_file;
+            const uchar *m_map;
+            qint64 m_size;
+            int m_count;
+            const uchar *m_fanout;
+            const uchar *m_oids;
+            const uchar *m_entries;
+
+            Q_DISABLE_COPY(QGitMappedDatabaseBackend)
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_MAPPEDDATABASEBACKEND_H
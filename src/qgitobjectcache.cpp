@@ -0,0 +1,356 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitobjectcache.h"
+
+#include "qgitexception.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QPair>
+
+#include <git2/odb.h>
+
+namespace LibQGit2
+{
+
+namespace
+{
+
+const int TypeCount = 4;
+const int MaxShards = 256;
+
+const qint64 DefaultMaxBytes[TypeCount] = {
+    16 * 1024 * 1024,       // commits
+    32 * 1024 * 1024,       // trees
+    128 * 1024 * 1024,      // blobs
+    1 * 1024 * 1024         // tags
+};
+
+/**
+ * Index of the budget of type, or -1 for types that are never cached.
+ */
+int typeIndex(git_otype type)
+{
+    switch (type)
+    {
+    case GIT_OBJ_COMMIT:
+    case GIT_OBJ_TREE:
+    case GIT_OBJ_BLOB:
+    case GIT_OBJ_TAG:
+        return int(type) - int(GIT_OBJ_COMMIT);
+    default:
+        return -1;
+    }
+}
+
+}
+
+/**
+ * One lock, an index and a CLOCK ring per object type.
+ */
+struct QGitObjectCache::Shard
+{
+    struct Slot
+    {
+        QGitRawObject object;
+        bool referenced;
+    };
+
+    struct Ring
+    {
+        Ring() : hand(0), bytes(0), maxBytes(0) {}
+
+        QVector<Slot> slots;
+        QVector<int> free;      // empty slots
+        int hand;
+        qint64 bytes;
+        qint64 maxBytes;
+    };
+
+    Shard() : hits(0), misses(0), evictions(0) {}
+
+    QGitRawObject find(const QGitOId &oid)
+    {
+        QHash<QGitOId, QPair<int, int> >::const_iterator it = index.constFind(oid);
+        if (it == index.constEnd())
+        {
+            ++misses;
+            return QGitRawObject();
+        }
+
+        ++hits;
+        Slot &slot = rings[it.value().first].slots[it.value().second];
+        slot.referenced = true;
+        return slot.object;
+    }
+
+    void insert(const QGitOId &oid, const QGitRawObject &object, int type)
+    {
+        Ring &ring = rings[type];
+        const qint64 size = object.rawSize();
+        if (size > ring.maxBytes || index.contains(oid))
+        {
+            return;
+        }
+        evict(type, size);
+
+        Slot slot;
+        slot.object = object;
+        slot.referenced = false;
+
+        int pos;
+        if (!ring.free.isEmpty())
+        {
+            pos = ring.free.last();
+            ring.free.removeLast();
+            ring.slots[pos] = slot;
+        }
+        else
+        {
+            pos = ring.slots.size();
+            ring.slots.append(slot);
+        }
+        ring.bytes += size;
+        index.insert(oid, qMakePair(type, pos));
+    }
+
+    /**
+     * Evict objects of type until incoming more bytes fit in the budget.
+     * Slots read since the hand last passed get a second chance.
+     */
+    void evict(int type, qint64 incoming)
+    {
+        Ring &ring = rings[type];
+        while (ring.bytes > 0 && ring.bytes + incoming > ring.maxBytes)
+        {
+            if (ring.hand >= ring.slots.size())
+            {
+                ring.hand = 0;
+            }
+
+            Slot &slot = ring.slots[ring.hand];
+            if (slot.referenced)
+            {
+                slot.referenced = false;
+            }
+            else if (!slot.object.isNull())
+            {
+                index.remove(slot.object.oid());
+                ring.bytes -= slot.object.rawSize();
+                slot.object = QGitRawObject();
+                ring.free.append(ring.hand);
+                ++evictions;
+            }
+            ++ring.hand;
+        }
+    }
+
+    void clear()
+    {
+        index.clear();
+        for (int type = 0; type < TypeCount; ++type)
+        {
+            Ring &ring = rings[type];
+            ring.slots.clear();
+            ring.free.clear();
+            ring.hand = 0;
+            ring.bytes = 0;
+        }
+    }
+
+    QMutex mutex;
+    QHash<QGitOId, QPair<int, int> > index;     // type and slot
+    Ring rings[TypeCount];
+    quint64 hits;
+    quint64 misses;
+    quint64 evictions;
+};
+
+QGitObjectCache::QGitObjectCache(const QGitDatabase& database, int shards)
+    : m_database(database)
+{
+    int count = 1;
+    while (count < shards && count < MaxShards)
+    {
+        count <<= 1;
+    }
+    m_shardMask = count - 1;
+
+    m_shards.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        Shard *shard = new Shard;
+        for (int type = 0; type < TypeCount; ++type)
+        {
+            shard->rings[type].maxBytes = DefaultMaxBytes[type] / count;
+        }
+        m_shards.append(shard);
+    }
+
+    for (int type = 0; type < TypeCount; ++type)
+    {
+        m_maxBytes[type] = DefaultMaxBytes[type];
+    }
+}
+
+QGitObjectCache::~QGitObjectCache()
+{
+    qDeleteAll(m_shards);
+}
+
+void QGitObjectCache::setMaxBytes(git_otype type, qint64 maxBytes)
+{
+    const int index = typeIndex(type);
+    if (index < 0)
+    {
+        return;
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_maxBytes[index] = maxBytes;
+    foreach (Shard *shard, m_shards)
+    {
+        QMutexLocker shardLock(&shard->mutex);
+        shard->rings[index].maxBytes = maxBytes / m_shards.size();
+        shard->evict(index, 0);
+    }
+}
+
+qint64 QGitObjectCache::maxBytes(git_otype type) const
+{
+    const int index = typeIndex(type);
+    if (index < 0)
+    {
+        return 0;
+    }
+
+    QMutexLocker lock(&m_mutex);
+    return m_maxBytes[index];
+}
+
+qint64 QGitObjectCache::bytes(git_otype type) const
+{
+    const int index = typeIndex(type);
+    if (index < 0)
+    {
+        return 0;
+    }
+
+    qint64 total = 0;
+    foreach (Shard *shard, m_shards)
+    {
+        QMutexLocker lock(&shard->mutex);
+        total += shard->rings[index].bytes;
+    }
+    return total;
+}
+
+QGitRawObject QGitObjectCache::lookup(const QGitOId& oid)
+{
+    git_odb_object *object = NULL;
+    if (oid.length() < GIT_OID_HEXSZ)
+    {
+        qGitThrow(git_odb_read_prefix(&object, m_database.data(), oid.constData(), oid.length()));
+        QGitRawObject found(object);
+        insert(found);
+        return found;
+    }
+
+    QGitRawObject found = cached(oid);
+    if (found.isNull())
+    {
+        // read without holding the lock; a thread racing for the same
+        // object only makes insert() keep the first copy
+        qGitThrow(git_odb_read(&object, m_database.data(), oid.constData()));
+        found = QGitRawObject(object);
+        insert(found);
+    }
+    return found;
+}
+
+QGitRawObject QGitObjectCache::cached(const QGitOId& oid)
+{
+    Shard &s = shard(oid.constData());
+    QMutexLocker lock(&s.mutex);
+    return s.find(oid);
+}
+
+void QGitObjectCache::clear()
+{
+    foreach (Shard *shard, m_shards)
+    {
+        QMutexLocker lock(&shard->mutex);
+        shard->clear();
+    }
+}
+
+quint64 QGitObjectCache::hits() const
+{
+    quint64 total = 0;
+    foreach (Shard *shard, m_shards)
+    {
+        QMutexLocker lock(&shard->mutex);
+        total += shard->hits;
+    }
+    return total;
+}
+
+quint64 QGitObjectCache::misses() const
+{
+    quint64 total = 0;
+    foreach (Shard *shard, m_shards)
+    {
+        QMutexLocker lock(&shard->mutex);
+        total += shard->misses;
+    }
+    return total;
+}
+
+quint64 QGitObjectCache::evictions() const
+{
+    quint64 total = 0;
+    foreach (Shard *shard, m_shards)
+    {
+        QMutexLocker lock(&shard->mutex);
+        total += shard->evictions;
+    }
+    return total;
+}
+
+QGitObjectCache::Shard& QGitObjectCache::shard(const git_oid *oid) const
+{
+    return *m_shards.at(oid->id[0] & m_shardMask);
+}
+
+void QGitObjectCache::insert(const QGitRawObject& object)
+{
+    const int type = typeIndex(object.type());
+    if (type < 0)
+    {
+        return;
+    }
+
+    const QGitOId oid = object.oid();
+    Shard &s = shard(oid.constData());
+    QMutexLocker lock(&s.mutex);
+    s.insert(oid, object, type);
+}
+
+} // namespace LibQGit2
@@ -0,0 +1,122 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_OBJECTCACHE_H
+#define LIBQGIT2_OBJECTCACHE_H
+
+#include "../libqgit2_export.h"
+
+#include "qgitdatabase.h"
+#include "qgitoid.h"
+#include "qgitrawobject.h"
+
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+
+#include <git2/types.h>
+
+namespace LibQGit2
+{
+    /**
+     * @brief Thread safe cache of raw objects in front of a QGitDatabase.
+     *
+     * The cache is split into shards by the first byte of the object id, each
+     * with its own lock, so threads reading different objects rarely wait
+     * for each other. Every object type has its own byte budget, split
+     * evenly between the shards; a shard over budget evicts objects of that
+     * type with the CLOCK policy, sparing the ones read since the hand last
+     * passed. Objects are read from the database without holding any lock.
+     *
+     * Objects are returned as shared QGitRawObject copies: evicting one
+     * never invalidates a copy a caller still holds.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_DATABASE_EXPORT QGitObjectCache
+    {
+        public:
+            /**
+             * @param database the database objects are read from; it must
+             * outlive the cache
+             * @param shards number of shards, rounded up to a power of two
+             * no greater than 256
+             */
+            explicit QGitObjectCache(const QGitDatabase& database, int shards = 64);
+
+            ~QGitObjectCache();
+
+            /**
+             * Set the budget of objects of type, in bytes of content.
+             * Objects over the new budget are evicted at once.
+             */
+            void setMaxBytes(git_otype type, qint64 maxBytes);
+
+            qint64 maxBytes(git_otype type) const;
+
+            /**
+             * Bytes of content of the cached objects of type.
+             */
+            qint64 bytes(git_otype type) const;
+
+            /**
+             * The object oid, read from the database if it is not cached.
+             * Abbreviated ids are resolved by the database and the object
+             * is cached under its full id.
+             * @throws QGitException
+             */
+            QGitRawObject lookup(const QGitOId& oid);
+
+            /**
+             * The object oid if it is cached, otherwise a null object. Counts
+             * as a hit or a miss like lookup().
+             */
+            QGitRawObject cached(const QGitOId& oid);
+
+            /**
+             * Drop every cached object; the counters are kept.
+             */
+            void clear();
+
+            quint64 hits() const;
+
+            quint64 misses() const;
+
+            quint64 evictions() const;
+
+        private:
+            Q_DISABLE_COPY(QGitObjectCache)
+
+            struct Shard;
+
+            Shard& shard(const git_oid *oid) const;
+            void insert(const QGitRawObject& object);
+
+            QGitDatabase m_database;
+            QVector<Shard*> m_shards;
+            int m_shardMask;
+
+            mutable QMutex m_mutex;     // guards m_maxBytes
+            qint64 m_maxBytes[4];       // by type, commit to tag
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_OBJECTCACHE_H
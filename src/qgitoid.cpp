@@ -100,6 +100,20 @@ bool operator !=(const QGitOId &oid1, const QGitOId &oid2)
     return !(operator ==(oid1, oid2));
 }
 
+uint qHash(const QGitOId &oid)
+{
+    // the oid is a sha1, so its leading bytes are already well distributed;
+    // prefixes created by fromString() may be shorter than four bytes though
+    const uchar *raw = reinterpret_cast<const uchar*>(oid.constData()->id);
+    int len = qMin(oid.length() / 2, 4);
+    uint h = 0;
+    for (int i = 0; i < len; ++i)
+    {
+        h = (h << 8) | raw[i];
+    }
+    return h;
+}
+
 int QGitOId::length() const
 {
     return d.length() * 2;
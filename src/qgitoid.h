@@ -116,6 +116,10 @@ namespace LibQGit2
      * Compare two QGitOIds.
      */
     bool operator !=(const QGitOId &oid1, const QGitOId &oid2);
+    /**
+     * Hash function so QGitOIds can be used as QHash and QCache keys.
+     */
+    uint qHash(const QGitOId &oid);
 
     /**@}*/
 }
@@ -0,0 +1,324 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitpathwalk.h"
+
+#include "qgitexception.h"
+
+#include <git2/commit.h>
+#include <git2/errors.h>
+#include <git2/tree.h>
+
+#include <string.h>
+
+namespace LibQGit2
+{
+
+namespace
+{
+
+struct TreeGuard
+{
+    TreeGuard() : tree(NULL) {}
+    ~TreeGuard() { git_tree_free(tree); }
+
+    git_tree *tree;
+};
+
+/**
+ * Append the id and mode of the entry at path to signature; zeros when
+ * there is no such entry.
+ */
+void appendEntry(QByteArray &signature, git_tree *tree, const QByteArray &path)
+{
+    char bytes[GIT_OID_RAWSZ + 4];
+    memset(bytes, 0, sizeof(bytes));
+
+    git_tree_entry *entry = NULL;
+    int err = git_tree_entry_bypath(&entry, tree, path.constData());
+    if (err != GIT_ENOTFOUND)
+    {
+        qGitThrow(err);
+        memcpy(bytes, git_tree_entry_id(entry)->id, GIT_OID_RAWSZ);
+        const quint32 mode = git_tree_entry_filemode(entry);
+        memcpy(bytes + GIT_OID_RAWSZ, &mode, 4);
+        git_tree_entry_free(entry);
+    }
+
+    signature.append(bytes, sizeof(bytes));
+}
+
+}
+
+bool QGitPathWalk::Entry::operator<(const Entry& other) const
+{
+    if (time != other.time)
+    {
+        return time < other.time;
+    }
+    // commits seen first come out first
+    return node > other.node;
+}
+
+QGitPathWalk::QGitPathWalk(const QGitRepository& repository)
+    : m_repo(repository)
+    , m_simplify(true)
+    , m_prepared(false)
+    , m_interesting(0)
+{
+}
+
+QGitPathWalk::~QGitPathWalk()
+{
+}
+
+void QGitPathWalk::setPaths(const QStringList& paths)
+{
+    m_paths = paths;
+    m_pathBytes.clear();
+    foreach (QString path, paths)
+    {
+        while (path.endsWith('/'))
+        {
+            path.chop(1);
+        }
+        m_pathBytes.append(path.toUtf8());
+    }
+    restart();
+}
+
+QStringList QGitPathWalk::paths() const
+{
+    return m_paths;
+}
+
+void QGitPathWalk::setSimplifyHistory(bool simplify)
+{
+    m_simplify = simplify;
+    restart();
+}
+
+bool QGitPathWalk::simplifyHistory() const
+{
+    return m_simplify;
+}
+
+void QGitPathWalk::push(const QGitOId& commit)
+{
+    m_pushed.append(commit);
+    restart();
+}
+
+void QGitPathWalk::hide(const QGitOId& commit)
+{
+    m_hidden.append(commit);
+    restart();
+}
+
+void QGitPathWalk::reset()
+{
+    m_pushed.clear();
+    m_hidden.clear();
+    restart();
+}
+
+void QGitPathWalk::restart()
+{
+    m_index.clear();
+    m_nodes.clear();
+    m_queue = std::priority_queue<Entry>();
+    m_interesting = 0;
+    m_prepared = false;
+}
+
+int QGitPathWalk::node(const QGitOId& oid)
+{
+    QHash<QGitOId, int>::const_iterator it = m_index.constFind(oid);
+    if (it != m_index.constEnd())
+    {
+        return it.value();
+    }
+
+    git_commit *commit = NULL;
+    qGitThrow(git_commit_lookup(&commit, m_repo.data(), oid.constData()));
+
+    Node n;
+    n.oid = oid;
+    git_oid_cpy(&n.tree, git_commit_tree_id(commit));
+    n.time = git_commit_time(commit);
+    const unsigned count = git_commit_parentcount(commit);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        n.parents.append(QGitOId(git_commit_parent_id(commit, i)));
+    }
+    n.flags = 0;
+    git_commit_free(commit);
+
+    m_index.insert(oid, m_nodes.size());
+    m_nodes.append(n);
+    return m_nodes.size() - 1;
+}
+
+QByteArray QGitPathWalk::signature(int node)
+{
+    Node &n = m_nodes[node];
+    if (n.flags & HasSignature)
+    {
+        return n.signature;
+    }
+
+    if (m_pathBytes.isEmpty())
+    {
+        n.signature = QByteArray(reinterpret_cast<const char*>(n.tree.id), GIT_OID_RAWSZ);
+    }
+    else
+    {
+        TreeGuard root;
+        qGitThrow(git_tree_lookup(&root.tree, m_repo.data(), &n.tree));
+
+        n.signature.reserve(m_pathBytes.size() * (GIT_OID_RAWSZ + 4));
+        foreach (const QByteArray &path, m_pathBytes)
+        {
+            appendEntry(n.signature, root.tree, path);
+        }
+    }
+
+    n.flags |= HasSignature;
+    return n.signature;
+}
+
+bool QGitPathWalk::sameEntries(int node, int parent)
+{
+    // an unchanged root tree needs no lookup at all
+    if (git_oid_equal(&m_nodes.at(node).tree, &m_nodes.at(parent).tree))
+    {
+        return true;
+    }
+    return signature(node) == signature(parent);
+}
+
+void QGitPathWalk::enqueue(int node, bool hidden)
+{
+    Node &n = m_nodes[node];
+    if (n.flags & Seen)
+    {
+        if (hidden && !(n.flags & Hidden))
+        {
+            n.flags |= Hidden;
+            if (!(n.flags & Popped))
+            {
+                --m_interesting;
+            }
+        }
+        return;
+    }
+
+    n.flags |= Seen | (hidden ? Hidden : 0);
+    if (!hidden)
+    {
+        ++m_interesting;
+    }
+
+    Entry entry;
+    entry.time = n.time;
+    entry.node = node;
+    m_queue.push(entry);
+}
+
+bool QGitPathWalk::next(QGitOId& oid)
+{
+    if (!m_prepared)
+    {
+        foreach (const QGitOId &commit, m_hidden)
+        {
+            enqueue(node(commit), true);
+        }
+        foreach (const QGitOId &commit, m_pushed)
+        {
+            enqueue(node(commit), false);
+        }
+        m_prepared = true;
+    }
+
+    QVector<int> parents;
+    while (m_interesting > 0 && !m_queue.empty())
+    {
+        const int current = m_queue.top().node;
+        m_queue.pop();
+
+        m_nodes[current].flags |= Popped;
+        const bool hidden = m_nodes.at(current).flags & Hidden;
+
+        // node() may grow m_nodes, so no reference is kept across it
+        parents.clear();
+        foreach (const QGitOId &parent, m_nodes.at(current).parents)
+        {
+            parents.append(node(parent));
+        }
+
+        if (hidden)
+        {
+            foreach (int parent, parents)
+            {
+                enqueue(parent, true);
+            }
+            continue;
+        }
+        --m_interesting;
+
+        int same = -1;
+        foreach (int parent, parents)
+        {
+            if (sameEntries(current, parent))
+            {
+                same = parent;
+                break;
+            }
+        }
+
+        if (m_simplify && same >= 0)
+        {
+            enqueue(same, false);
+        }
+        else
+        {
+            foreach (int parent, parents)
+            {
+                enqueue(parent, false);
+            }
+        }
+
+        bool touched = same < 0;
+        if (parents.isEmpty() && !m_pathBytes.isEmpty())
+        {
+            // a root commit counts when it adds any of the paths
+            touched = signature(current) != QByteArray(m_pathBytes.size() * (GIT_OID_RAWSZ + 4), '\0');
+        }
+
+        if (touched)
+        {
+            oid = m_nodes.at(current).oid;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace LibQGit2
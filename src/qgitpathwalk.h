@@ -0,0 +1,153 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_PATHWALK_H
+#define LIBQGIT2_PATHWALK_H
+
+#include "../libqgit2_export.h"
+
+#include "qgitrepository.h"
+#include "qgitoid.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+#include <git2/oid.h>
+
+#include <queue>
+
+namespace LibQGit2
+{
+    /**
+     * @brief History walk limited to paths, like "git log -- path".
+     *
+     * A commit is returned when the entries at the given paths differ from
+     * every one of its parents. The check never builds a diff: for every
+     * commit the object ids (and modes) of the entries at the paths are read
+     * once from its tree and compared with those of the parents, and commits
+     * whose root tree is unchanged are skipped without reading any tree.
+     *
+     * With history simplification (the default) a commit that matches one
+     * of its parents is followed through that parent only, so side branches
+     * which did not touch the paths are never visited. Without it every
+     * parent is followed.
+     *
+     * Commits are returned by commit time, newest first.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_REVWALK_EXPORT QGitPathWalk
+    {
+        public:
+            explicit QGitPathWalk(const QGitRepository& repository);
+
+            ~QGitPathWalk();
+
+            /**
+             * Limit the walk to commits touching paths, given relative to the
+             * root of the repository. A directory matches everything below it.
+             * No paths means the whole tree. Resets the walk.
+             */
+            void setPaths(const QStringList& paths);
+            QStringList paths() const;
+
+            /**
+             * Follow only a parent with the same entries, when there is one.
+             * Resets the walk.
+             */
+            void setSimplifyHistory(bool simplify);
+            bool simplifyHistory() const;
+
+            /**
+             * Start the walk at commit.
+             */
+            void push(const QGitOId& commit);
+
+            /**
+             * Leave commit and its ancestors out of the walk.
+             */
+            void hide(const QGitOId& commit);
+
+            /**
+             * Forget the pushed and hidden commits.
+             */
+            void reset();
+
+            /**
+             * Get the next commit touching the paths.
+             * @return false once the walk is over
+             * @throws QGitException
+             */
+            bool next(QGitOId& oid);
+
+        private:
+            enum Flag
+            {
+                Seen            = 0x1,
+                Hidden          = 0x2,
+                Popped          = 0x4,
+                HasSignature    = 0x8
+            };
+
+            struct Node
+            {
+                QGitOId oid;
+                git_oid tree;
+                qint64 time;
+                QList<QGitOId> parents;
+                QByteArray signature;   // id and mode of every path
+                uchar flags;
+            };
+
+            struct Entry
+            {
+                qint64 time;
+                int node;
+
+                bool operator<(const Entry& other) const;
+            };
+
+            void restart();
+            int node(const QGitOId& oid);
+            QByteArray signature(int node);
+            bool sameEntries(int node, int parent);
+            void enqueue(int node, bool hidden);
+
+            QGitRepository m_repo;
+            QStringList m_paths;
+            QList<QByteArray> m_pathBytes;
+            bool m_simplify;
+            QList<QGitOId> m_pushed;
+            QList<QGitOId> m_hidden;
+            bool m_prepared;
+
+            QHash<QGitOId, int> m_index;
+            QVector<Node> m_nodes;
+            std::priority_queue<Entry> m_queue;
+            int m_interesting;
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_PATHWALK_H
@@ -0,0 +1,81 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitrawobject.h"
+
+#include <git2/odb.h>
+
+namespace LibQGit2
+{
+
+QGitRawObject::QGitRawObject(git_odb_object *object)
+    : d(object, git_odb_object_free)
+{
+}
+
+QGitRawObject::QGitRawObject(const QGitRawObject& other)
+    : d(other.d)
+{
+}
+
+QGitRawObject::~QGitRawObject()
+{
+}
+
+bool QGitRawObject::isNull() const
+{
+    return d.isNull();
+}
+
+QGitOId QGitRawObject::oid() const
+{
+    return QGitOId(git_odb_object_id(data()));
+}
+
+git_otype QGitRawObject::type() const
+{
+    return git_odb_object_type(data());
+}
+
+const void* QGitRawObject::rawContent() const
+{
+    return git_odb_object_data(data());
+}
+
+QByteArray QGitRawObject::content() const
+{
+    return QByteArray::fromRawData(static_cast<const char *>(rawContent()), rawSize());
+}
+
+int QGitRawObject::rawSize() const
+{
+    return int(git_odb_object_size(data()));
+}
+
+git_odb_object* QGitRawObject::data() const
+{
+    return d.data();
+}
+
+const git_odb_object* QGitRawObject::constData() const
+{
+    return d.data();
+}
+
+} // namespace LibQGit2
@@ -0,0 +1,90 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_RAWOBJECT_H
+#define LIBQGIT2_RAWOBJECT_H
+
+#include "../libqgit2_export.h"
+
+#include "qgitoid.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QSharedPointer>
+
+#include <git2/types.h>
+
+namespace LibQGit2
+{
+    /**
+     * @brief Wrapper class for git_odb_object.
+     * Represents an object read straight from the object database: its
+     * type and its uncompressed content, without parsing.
+     *
+     * Copies share the same object, which is released with the last copy.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_RAWOBJECT_EXPORT QGitRawObject
+    {
+        public:
+
+            /**
+             * Creates a QGitRawObject that points to object. The pointer object becomes
+             * managed by this QGitRawObject, and must not be freed outside this object.
+             */
+            explicit QGitRawObject(git_odb_object *object = 0);
+
+            QGitRawObject(const QGitRawObject& other);
+
+            ~QGitRawObject();
+
+            bool isNull() const;
+
+            QGitOId oid() const;
+
+            git_otype type() const;
+
+            /**
+             * Get a read-only buffer with the content of the object. It stays
+             * valid as long as a copy of this QGitRawObject exists.
+             */
+            const void* rawContent() const;
+
+            /**
+             * @return The content as a QByteArray sharing the buffer of rawContent().
+             */
+            QByteArray content() const;
+
+            /**
+             * Size in bytes of the content.
+             */
+            int rawSize() const;
+
+            git_odb_object* data() const;
+            const git_odb_object* constData() const;
+
+        private:
+            QSharedPointer<git_odb_object> d;
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_RAWOBJECT_H
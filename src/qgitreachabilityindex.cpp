@@ -0,0 +1,628 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitreachabilityindex.h"
+
+#include "qgitcommitgraph.h"
+#include "qgitexception.h"
+
+#include <QtCore/QBitArray>
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QPair>
+
+#include <git2/commit.h>
+#include <git2/errors.h>
+#include <git2/object.h>
+#include <git2/revparse.h>
+
+#include <algorithm>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace LibQGit2
+{
+
+/*
+ * File layout, all numbers big endian:
+ *
+ *   "QRBI", version, commit count, reference count     4 x 4 bytes
+ *   commit ids, by bit position                        count x 20 bytes
+ *   per reference: name length, name, tip id,
+ *                  word count, EWAH words (8 bytes each)
+ *
+ * An EWAH bitmap is a sequence of marker words, each followed by the
+ * literal words it announces. A marker holds the value of a run of clean
+ * (all 0 or all 1) words in bit 0, the length of that run in bits 1-32 and
+ * the number of literal words that follow in bits 33-63.
+ */
+
+namespace
+{
+
+const char Magic[4] = { 'Q', 'R', 'B', 'I' };
+const quint32 Version = 1;
+
+const quint64 AllOnes = ~quint64(0);
+const quint64 MaxRun = 0xffffffffu;
+const quint64 MaxLiterals = 0x7fffffffu;
+
+inline quint64 runBit(quint64 marker)
+{
+    return marker & 1;
+}
+
+inline quint64 runLength(quint64 marker)
+{
+    return (marker >> 1) & MaxRun;
+}
+
+inline quint64 literalCount(quint64 marker)
+{
+    return marker >> 33;
+}
+
+inline bool testBit(const QVector<quint64>& bits, int pos)
+{
+    const int word = pos / 64;
+    return word < bits.size() && (bits.at(word) >> (pos % 64)) & 1;
+}
+
+inline void setBit(QVector<quint64>& bits, int pos)
+{
+    const int word = pos / 64;
+    if (word >= bits.size())
+    {
+        bits.resize(word + 1);
+    }
+    bits[word] |= quint64(1) << (pos % 64);
+}
+
+QVector<quint64> compress(const QVector<quint64>& bits)
+{
+    QVector<quint64> words;
+    int end = bits.size();
+    while (end > 0 && bits.at(end - 1) == 0)
+    {
+        --end;
+    }
+
+    int i = 0;
+    while (i < end)
+    {
+        quint64 run = 0;
+        const quint64 clean = bits.at(i);
+        if (clean == 0 || clean == AllOnes)
+        {
+            while (i < end && bits.at(i) == clean && run < MaxRun)
+            {
+                ++run;
+                ++i;
+            }
+        }
+
+        const int literals = i;
+        while (i < end && bits.at(i) != 0 && bits.at(i) != AllOnes
+                && quint64(i - literals) < MaxLiterals)
+        {
+            ++i;
+        }
+
+        const quint64 bit = (run > 0 && clean == AllOnes) ? 1 : 0;
+        words.append(bit | (run << 1) | (quint64(i - literals) << 33));
+        for (int l = literals; l < i; ++l)
+        {
+            words.append(bits.at(l));
+        }
+    }
+
+    return words;
+}
+
+/**
+ * bits |= the compressed bitmap words
+ */
+void orInto(const QVector<quint64>& words, QVector<quint64>& bits)
+{
+    int word = 0;
+    int i = 0;
+    while (i < words.size())
+    {
+        const quint64 marker = words.at(i++);
+        const int run = int(runLength(marker));
+        const int literals = int(literalCount(marker));
+
+        const int needed = word + run + literals;
+        if (needed > bits.size())
+        {
+            bits.resize(needed);
+        }
+
+        if (runBit(marker))
+        {
+            for (int w = word; w < word + run; ++w)
+            {
+                bits[w] = AllOnes;
+            }
+        }
+        word += run;
+
+        for (int l = 0; l < literals; ++l)
+        {
+            bits[word++] |= words.at(i++);
+        }
+    }
+}
+
+typedef QPair<int, int> Query;     // bit position, index of the query
+
+/**
+ * Set hits[q] for every query whose bit is set in the compressed bitmap.
+ * queries must be sorted by position; the bitmap is scanned once.
+ */
+void testSorted(const QVector<quint64>& words, const QVector<Query>& queries, QBitArray& hits)
+{
+    int q = 0;
+    qint64 word = 0;
+    int i = 0;
+
+    while (i < words.size() && q < queries.size())
+    {
+        const quint64 marker = words.at(i++);
+        const qint64 runEnd = word + qint64(runLength(marker));
+
+        while (q < queries.size() && queries.at(q).first / 64 < runEnd)
+        {
+            if (runBit(marker))
+            {
+                hits.setBit(queries.at(q).second);
+            }
+            ++q;
+        }
+        word = runEnd;
+
+        const int literals = int(literalCount(marker));
+        for (int l = 0; l < literals; ++l, ++word)
+        {
+            const quint64 bits = words.at(i + l);
+            while (q < queries.size() && queries.at(q).first / 64 == word)
+            {
+                if ((bits >> (queries.at(q).first % 64)) & 1)
+                {
+                    hits.setBit(queries.at(q).second);
+                }
+                ++q;
+            }
+        }
+        i += literals;
+    }
+}
+
+struct PositionLess
+{
+    explicit PositionLess(const QVector<git_oid> &commits) : commits(commits) {}
+
+    bool operator()(int a, int b) const
+    {
+        return git_oid_cmp(&commits.at(a), &commits.at(b)) < 0;
+    }
+
+    const QVector<git_oid> &commits;
+};
+
+void throwFileError(const char *message)
+{
+    giterr_set_str(GITERR_OS, message);
+    qGitThrow(GIT_ERROR);
+}
+
+}
+
+QGitReachabilityIndex::QGitReachabilityIndex(const QGitRepository& repository)
+    : m_repo(repository)
+{
+}
+
+QGitReachabilityIndex::~QGitReachabilityIndex()
+{
+}
+
+QString QGitReachabilityIndex::filePath(const QGitRepository& repository)
+{
+    return repository.path() + QLatin1String("objects/info/qgit-reachability");
+}
+
+bool QGitReachabilityIndex::load()
+{
+    m_commits.clear();
+    m_sorted.clear();
+    m_appended.clear();
+    m_refs.clear();
+
+    QFile file(filePath(m_repo));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::BigEndian);
+
+    char magic[sizeof(Magic)];
+    quint32 version = 0, commitCount = 0, refCount = 0;
+    in.readRawData(magic, sizeof(magic));
+    in >> version >> commitCount >> refCount;
+    if (in.status() != QDataStream::Ok || memcmp(magic, Magic, sizeof(Magic)) != 0
+            || version != Version || qint64(commitCount) * GIT_OID_RAWSZ > file.size())
+    {
+        return false;
+    }
+
+    m_commits.resize(int(commitCount));
+    in.readRawData(reinterpret_cast<char*>(m_commits.data()), int(commitCount) * GIT_OID_RAWSZ);
+
+    for (quint32 r = 0; r < refCount && in.status() == QDataStream::Ok; ++r)
+    {
+        RefBitmap ref;
+        quint32 nameLength = 0, wordCount = 0;
+
+        in >> nameLength;
+        if (nameLength > quint32(file.size()))
+        {
+            break;
+        }
+        ref.name.resize(int(nameLength));
+        in.readRawData(ref.name.data(), int(nameLength));
+        in.readRawData(reinterpret_cast<char*>(ref.tip.id), GIT_OID_RAWSZ);
+
+        in >> wordCount;
+        if (qint64(wordCount) * 8 > file.size())
+        {
+            break;
+        }
+        ref.words.resize(int(wordCount));
+        for (quint32 w = 0; w < wordCount; ++w)
+        {
+            in >> ref.words[int(w)];
+        }
+        m_refs.append(ref);
+    }
+
+    if (in.status() != QDataStream::Ok || m_refs.size() != int(refCount))
+    {
+        m_commits.clear();
+        m_refs.clear();
+        return false;
+    }
+
+    sortPositions();
+    return true;
+}
+
+void QGitReachabilityIndex::save() const
+{
+    QString path = filePath(m_repo);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QFile file(path + QLatin1String(".lock"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        throwFileError("failed to create the reachability index");
+    }
+
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::BigEndian);
+    out.writeRawData(Magic, sizeof(Magic));
+    out << Version << quint32(m_commits.size()) << quint32(m_refs.size());
+    out.writeRawData(reinterpret_cast<const char*>(m_commits.constData()),
+                     m_commits.size() * GIT_OID_RAWSZ);
+
+    foreach (const RefBitmap &ref, m_refs)
+    {
+        out << quint32(ref.name.size());
+        out.writeRawData(ref.name.constData(), ref.name.size());
+        out.writeRawData(reinterpret_cast<const char*>(ref.tip.id), GIT_OID_RAWSZ);
+        out << quint32(ref.words.size());
+        foreach (quint64 word, ref.words)
+        {
+            out << word;
+        }
+    }
+
+    file.close();
+    if (out.status() != QDataStream::Ok || file.error() != QFile::NoError)
+    {
+        file.remove();
+        throwFileError("failed to write the reachability index");
+    }
+
+    // rename() swaps the files in one step: load() sees either the old index
+    // or the new one, and a failure leaves the old index in place
+    if (::rename(QFile::encodeName(file.fileName()).constData(), QFile::encodeName(path).constData()) != 0)
+    {
+        file.remove();
+        throwFileError("failed to replace the reachability index");
+    }
+}
+
+void QGitReachabilityIndex::sortPositions()
+{
+    m_sorted.resize(m_commits.size());
+    for (int i = 0; i < m_sorted.size(); ++i)
+    {
+        m_sorted[i] = i;
+    }
+    std::sort(m_sorted.begin(), m_sorted.end(), PositionLess(m_commits));
+    m_appended.clear();
+}
+
+int QGitReachabilityIndex::position(const git_oid *oid) const
+{
+    int lo = 0, hi = m_sorted.size();
+    while (lo < hi)
+    {
+        const int mid = (lo + hi) / 2;
+        const int cmp = git_oid_cmp(&m_commits.at(m_sorted.at(mid)), oid);
+        if (cmp == 0)
+        {
+            return m_sorted.at(mid);
+        }
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return m_appended.value(QGitOId(oid), -1);
+}
+
+int QGitReachabilityIndex::positionOrAppend(const git_oid *oid)
+{
+    int pos = position(oid);
+    if (pos < 0)
+    {
+        pos = m_commits.size();
+        m_commits.append(*oid);
+        m_appended.insert(QGitOId(oid), pos);
+    }
+    return pos;
+}
+
+void QGitReachabilityIndex::parents(int pos, const QGitCommitGraph *graph, QVector<int>& out)
+{
+    out.clear();
+
+    // appending may move m_commits, so work on a copy of the id
+    const git_oid oid = m_commits.at(pos);
+
+    const int g = graph ? graph->find(&oid) : int(QGitCommitGraph::NotFound);
+    if (g != QGitCommitGraph::NotFound)
+    {
+        const int count = graph->parentCount(g);
+        for (int n = 0; n < count; ++n)
+        {
+            const int p = graph->parent(g, n);
+            if (p != QGitCommitGraph::NotFound)
+            {
+                out.append(positionOrAppend(graph->oid(p).constData()));
+            }
+        }
+        return;
+    }
+
+    git_commit *commit = NULL;
+    qGitThrow(git_commit_lookup(&commit, m_repo.data(), &oid));
+    const unsigned count = git_commit_parentcount(commit);
+    for (unsigned n = 0; n < count; ++n)
+    {
+        out.append(positionOrAppend(git_commit_parent_id(commit, n)));
+    }
+    git_commit_free(commit);
+}
+
+void QGitReachabilityIndex::mark(int start, QVector<quint64>& bits,
+                                 const QHash<int, const QVector<quint64>*>& known,
+                                 const QGitCommitGraph *graph)
+{
+    QVector<int> stack;
+    QVector<int> next;
+    stack.append(start);
+
+    while (!stack.isEmpty())
+    {
+        const int pos = stack.last();
+        stack.pop_back();
+        if (testBit(bits, pos))
+        {
+            continue;
+        }
+
+        // everything below a known tip is in its bitmap already
+        const QVector<quint64> *reachable = known.value(pos);
+        if (reachable)
+        {
+            orInto(*reachable, bits);
+            continue;
+        }
+
+        setBit(bits, pos);
+        parents(pos, graph, next);
+        foreach (int p, next)
+        {
+            if (!testBit(bits, p))
+            {
+                stack.append(p);
+            }
+        }
+    }
+}
+
+bool QGitReachabilityIndex::update(const QGitCommitGraph *graph)
+{
+    QStringList names = m_repo.listReferences();
+    names.sort();
+
+    QHash<QByteArray, int> previous;
+    for (int i = 0; i < m_refs.size(); ++i)
+    {
+        previous.insert(m_refs.at(i).name, i);
+    }
+
+    bool changed = false;
+    QVector<RefBitmap> refs;
+    refs.reserve(names.size());
+
+    // tips whose bitmap is final; the pointers stay valid as refs never reallocates
+    QHash<int, const QVector<quint64>*> known;
+
+    foreach (const QString &name, names)
+    {
+        RefBitmap ref;
+        ref.name = name.toUtf8();
+
+        // tags may point to something else than a commit
+        git_object *object = NULL;
+        if (git_revparse_single(&object, m_repo.data(), (ref.name + "^{commit}").constData()) != 0)
+        {
+            giterr_clear();
+            continue;
+        }
+        git_oid_cpy(&ref.tip, git_object_id(object));
+        git_object_free(object);
+
+        const int tip = positionOrAppend(&ref.tip);
+        const int old = previous.value(ref.name, -1);
+
+        if (old >= 0 && git_oid_equal(&m_refs.at(old).tip, &ref.tip))
+        {
+            ref.words = m_refs.at(old).words;
+        }
+        else
+        {
+            changed = true;
+
+            // after a fast-forward the walk stops at the previous tip
+            int oldTip = -1;
+            if (old >= 0)
+            {
+                oldTip = position(&m_refs.at(old).tip);
+                if (oldTip >= 0 && !known.contains(oldTip))
+                {
+                    known.insert(oldTip, &m_refs.at(old).words);
+                }
+                else
+                {
+                    oldTip = -1;
+                }
+            }
+
+            QVector<quint64> bits;
+            mark(tip, bits, known, graph);
+            ref.words = compress(bits);
+
+            if (oldTip >= 0)
+            {
+                known.remove(oldTip);
+            }
+        }
+
+        refs.append(ref);
+        if (!known.contains(tip))
+        {
+            known.insert(tip, &refs.last().words);
+        }
+    }
+
+    if (refs.size() != m_refs.size())
+    {
+        changed = true;
+    }
+    for (int i = 0; !changed && i < refs.size(); ++i)
+    {
+        changed = refs.at(i).name != m_refs.at(i).name;
+    }
+
+    m_refs = refs;
+    if (!m_appended.isEmpty())
+    {
+        sortPositions();
+    }
+    return changed;
+}
+
+int QGitReachabilityIndex::commitCount() const
+{
+    return m_commits.size();
+}
+
+QStringList QGitReachabilityIndex::references() const
+{
+    QStringList names;
+    foreach (const RefBitmap &ref, m_refs)
+    {
+        names.append(QString::fromUtf8(ref.name));
+    }
+    return names;
+}
+
+QStringList QGitReachabilityIndex::refsContaining(const QGitOId& commit) const
+{
+    return refsContaining(QList<QGitOId>() << commit).value(commit);
+}
+
+QHash<QGitOId, QStringList> QGitReachabilityIndex::refsContaining(const QList<QGitOId>& commits) const
+{
+    QHash<QGitOId, QStringList> result;
+    QVector<Query> queries;
+
+    for (int i = 0; i < commits.size(); ++i)
+    {
+        result.insert(commits.at(i), QStringList());
+
+        // commits the index does not know are not reachable from any reference
+        const int pos = commits.at(i).length() == GIT_OID_HEXSZ ? position(commits.at(i).constData()) : -1;
+        if (pos >= 0)
+        {
+            queries.append(qMakePair(pos, i));
+        }
+    }
+    std::sort(queries.begin(), queries.end());
+
+    foreach (const RefBitmap &ref, m_refs)
+    {
+        QBitArray hits(commits.size());
+        testSorted(ref.words, queries, hits);
+
+        const QString name = QString::fromUtf8(ref.name);
+        foreach (const Query &query, queries)
+        {
+            if (hits.testBit(query.second))
+            {
+                result[commits.at(query.second)].append(name);
+            }
+        }
+    }
+
+    return result;
+}
+
+} // namespace LibQGit2
@@ -0,0 +1,135 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_REACHABILITYINDEX_H
+#define LIBQGIT2_REACHABILITYINDEX_H
+
+#include "../libqgit2_export.h"
+
+#include "qgitrepository.h"
+#include "qgitoid.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+#include <git2/oid.h>
+
+namespace LibQGit2
+{
+    class QGitCommitGraph;
+
+    /**
+     * @brief On-disk index of the commits reachable from every reference.
+     *
+     * Every commit the index knows gets a bit position; positions are
+     * assigned in the order commits are first seen and never change, so
+     * existing bitmaps stay valid as history grows. For every reference the
+     * index stores an EWAH compressed bitmap of the commits reachable from
+     * its tip.
+     *
+     * update() only walks what moved: references whose tip did not change
+     * keep their bitmap, and a walk stops as soon as it reaches the tip of a
+     * bitmap that is already known (the reference's previous tip after a
+     * fast-forward, or any other reference). Parents are read from the
+     * commit graph when one is given, and from the commits otherwise.
+     *
+     * The index is stored in objects/info/qgit-reachability inside the git
+     * directory.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_REVWALK_EXPORT QGitReachabilityIndex
+    {
+        public:
+            explicit QGitReachabilityIndex(const QGitRepository& repository);
+
+            ~QGitReachabilityIndex();
+
+            /**
+             * Location of the index file of repository.
+             */
+            static QString filePath(const QGitRepository& repository);
+
+            /**
+             * Read the index file.
+             * @return false if there is no index or it is not valid; the index
+             * is empty then
+             */
+            bool load();
+
+            /**
+             * Write the index file.
+             * @throws QGitException
+             */
+            void save() const;
+
+            /**
+             * Bring the bitmaps up to date with the references of the repository.
+             * @param graph optional commit graph used to read parents
+             * @return true if anything changed
+             * @throws QGitException
+             */
+            bool update(const QGitCommitGraph *graph = 0);
+
+            /**
+             * Number of commits with a bit position.
+             */
+            int commitCount() const;
+
+            QStringList references() const;
+
+            /**
+             * Names of the references whose history contains commit.
+             */
+            QStringList refsContaining(const QGitOId& commit) const;
+
+            /**
+             * Names of the references containing each of commits. Every bitmap
+             * is scanned once for the whole batch.
+             */
+            QHash<QGitOId, QStringList> refsContaining(const QList<QGitOId>& commits) const;
+
+        private:
+            struct RefBitmap
+            {
+                QByteArray name;
+                git_oid tip;
+                QVector<quint64> words;
+            };
+
+            int position(const git_oid *oid) const;
+            int positionOrAppend(const git_oid *oid);
+            void parents(int pos, const QGitCommitGraph *graph, QVector<int>& out);
+            void mark(int start, QVector<quint64>& bits, const QHash<int, const QVector<quint64>*>& known,
+                      const QGitCommitGraph *graph);
+            void sortPositions();
+
+            QGitRepository m_repo;
+            QVector<git_oid> m_commits;         // by bit position
+            QVector<int> m_sorted;              // bit positions, sorted by oid
+            QHash<QGitOId, int> m_appended;     // positions not in m_sorted yet
+            QVector<RefBitmap> m_refs;
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_REACHABILITYINDEX_H
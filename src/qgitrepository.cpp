@@ -25,6 +25,9 @@
 #include "qgitblob.h"
 #include "qgitsignature.h"
 #include "qgitexception.h"
+#include "qgitaheadbehind.h"
+#include "qgitcommitgraph.h"
+#include "qgitreachabilityindex.h"
 
 #include <git2/errors.h>
 #include <git2/repository.h>
@@ -33,6 +36,7 @@
 #include <git2/tag.h>
 #include <git2/tree.h>
 #include <git2/blob.h>
+#include <git2/odb.h>
 
 #include <QtCore/QDir>
 #include <QtCore/QFile>
@@ -45,6 +49,13 @@
 
 namespace {
 void do_not_free(git_repository*) {}
+
+struct OdbGuard
+{
+    OdbGuard() : odb(NULL) {}
+    ~OdbGuard() { git_odb_free(odb); }
+    git_odb *odb;
+};
 }
 
 namespace LibQGit2
@@ -197,6 +208,21 @@ QGitBlob QGitRepository::lookupBlob(const QGitOId& oid) const
     return QGitBlob(blob);
 }
 
+QGitDatabase::ObjectHeader QGitRepository::objectHeader(const QGitOId& oid) const
+{
+    // database() hands out a reference the QGitDatabase never drops
+    OdbGuard guard;
+    qGitThrow(git_repository_odb(&guard.odb, data()));
+    return QGitDatabase(guard.odb).readHeader(oid);
+}
+
+int QGitRepository::objectHeaders(const QList<QGitOId>& oids, QVector<QGitDatabase::ObjectHeader>& headers) const
+{
+    OdbGuard guard;
+    qGitThrow(git_repository_odb(&guard.odb, data()));
+    return QGitDatabase(guard.odb).readHeaders(oids, headers);
+}
+
 QGitObject QGitRepository::lookupAny(const QGitOId &oid) const
 {
     git_object *object = 0;
@@ -303,6 +329,27 @@ QStringList QGitRepository::listReferences() const
     return list;
 }
 
+QStringList QGitRepository::refsContaining(const QGitOId& commit, bool saveIndex) const
+{
+    QGitCommitGraph graph(*this);
+    graph.open();
+
+    QGitReachabilityIndex index(*this);
+    index.load();
+    if (index.update(graph.isOpen() ? &graph : 0) && saveIndex)
+    {
+        index.save();
+    }
+    return index.refsContaining(commit);
+}
+
+QGitAheadBehind QGitRepository::aheadBehind(const QGitOId& base, const QList<QGitOId>& tips) const
+{
+    QGitCommitGraph graph(*this);
+    graph.open();
+    return QGitAheadBehind::compute(*this, base, tips, &graph);
+}
+
 QGitRef QGitRepository::createBranch(QString branchName, QGitCommit *commit, bool overwrite)
 {
     git_reference *newBranch;
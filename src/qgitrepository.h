@@ -38,6 +38,7 @@ struct git_repository;
 
 namespace LibQGit2
 {
+    class QGitAheadBehind;
     class QGitCommit;
     class QGitConfig;
     class QGitTag;
@@ -255,6 +256,23 @@ namespace LibQGit2
              */
             QGitBlob lookupBlob(const QGitOId& oid) const;
 
+            /**
+             * Type and size of an object, enough to tell a blob too large to
+             * show. See QGitDatabase::readHeader() for the cost: packed
+             * objects are read whole by libgit2.
+             *
+             * @throws QGitException
+             */
+            QGitDatabase::ObjectHeader objectHeader(const QGitOId& oid) const;
+
+            /**
+             * Type and size of every object of oids, e.g. the entries of a tree.
+             *
+             * @return the number of objects found
+             * @throws QGitException
+             */
+            int objectHeaders(const QList<QGitOId>& oids, QVector<QGitDatabase::ObjectHeader>& headers) const;
+
             /**
              * Lookup a reference to one of the objects in a repostory.
              *
@@ -370,6 +388,32 @@ namespace LibQGit2
              */
             QStringList listReferences() const;
 
+            /**
+             * List the references whose history contains commit.
+             *
+             * Answers from the reachability index of the repository, which is
+             * brought up to date in memory first if references moved. The
+             * commit graph is used for the update when one has been written.
+             * Use QGitReachabilityIndex directly to ask about many commits at once.
+             *
+             * The index file is only written when saveIndex is true and the
+             * update found something new; otherwise keep it fresh from a single
+             * writer with QGitReachabilityIndex::update() and save().
+             *
+             * @throws QGitException
+             */
+            QStringList refsContaining(const QGitOId& commit, bool saveIndex = false) const;
+
+            /**
+             * Count the commits each of tips is ahead and behind base, and find
+             * their merge bases, in one walk shared by all the tips.
+             *
+             * The commit graph of the repository is used when one has been written.
+             *
+             * @throws QGitException
+             */
+            QGitAheadBehind aheadBehind(const QGitOId& base, const QList<QGitOId>& tips) const;
+
 
             enum branchType
             {
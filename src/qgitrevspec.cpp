@@ -0,0 +1,275 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitrevspec.h"
+
+#include "qgitaheadbehind.h"
+#include "qgitcommitgraph.h"
+#include "qgitexception.h"
+#include "qgitrevwalk.h"
+
+#include <QtCore/QRegExp>
+
+#include <git2/errors.h>
+#include <git2/object.h>
+#include <git2/refs.h>
+#include <git2/revparse.h>
+
+namespace LibQGit2
+{
+
+namespace
+{
+
+/**
+ * The places git looks for a short reference name, in order.
+ */
+const char *const RefRules[] = {
+    "%1",
+    "refs/%1",
+    "refs/tags/%1",
+    "refs/heads/%1",
+    "refs/remotes/%1",
+    "refs/remotes/%1/HEAD"
+};
+
+struct ObjectGuard
+{
+    ObjectGuard() : object(NULL) {}
+    ~ObjectGuard() { git_object_free(object); }
+
+    git_object *object;
+};
+
+/**
+ * Return true if revision can only be a reference name or an object id.
+ */
+bool isPlainName(const QByteArray &revision)
+{
+    if (revision.isEmpty())
+    {
+        return false;
+    }
+    for (int i = 0; i < revision.size(); ++i)
+    {
+        switch (revision.at(i))
+        {
+        case '~':
+        case '^':
+        case '@':
+        case ':':
+        case '{':
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+QGitRevSpec::QGitRevSpec(const QGitRepository& repository)
+    : m_repo(repository)
+    , m_refsLoaded(false)
+{
+}
+
+QGitRevSpec::~QGitRevSpec()
+{
+}
+
+void QGitRevSpec::parse(const QString& expression)
+{
+    QList<QGitOId> pushed, hidden;
+    parseInto(expression, pushed, hidden);
+
+    // nothing is added unless the whole expression resolved
+    m_pushed << pushed;
+    m_hidden << hidden;
+}
+
+void QGitRevSpec::parse(const QStringList& expressions)
+{
+    QList<QGitOId> pushed, hidden;
+    foreach (const QString &expression, expressions)
+    {
+        parseInto(expression, pushed, hidden);
+    }
+
+    m_pushed << pushed;
+    m_hidden << hidden;
+}
+
+void QGitRevSpec::parseInto(const QString& expression, QList<QGitOId>& pushed, QList<QGitOId>& hidden)
+{
+    const QString head = QLatin1String("HEAD");
+
+    foreach (const QString &term, expression.split(QRegExp(QLatin1String("\\s+")), QString::SkipEmptyParts))
+    {
+        int dots = term.indexOf(QLatin1String("..."));
+        if (dots >= 0)
+        {
+            const QString left = term.left(dots);
+            const QString right = term.mid(dots + 3);
+            const QGitOId a = resolve(left.isEmpty() ? head : left);
+            const QGitOId b = resolve(right.isEmpty() ? head : right);
+
+            pushed << a << b;
+            hidden << mergeBases(a, b);
+            continue;
+        }
+
+        dots = term.indexOf(QLatin1String(".."));
+        if (dots >= 0)
+        {
+            const QString left = term.left(dots);
+            const QString right = term.mid(dots + 2);
+            hidden << resolve(left.isEmpty() ? head : left);
+            pushed << resolve(right.isEmpty() ? head : right);
+            continue;
+        }
+
+        if (term.startsWith(QLatin1Char('^')))
+        {
+            hidden << resolve(term.mid(1));
+        }
+        else
+        {
+            pushed << resolve(term);
+        }
+    }
+}
+
+QList<QGitOId> QGitRevSpec::pushed() const
+{
+    return m_pushed;
+}
+
+QList<QGitOId> QGitRevSpec::hidden() const
+{
+    return m_hidden;
+}
+
+void QGitRevSpec::apply(QGitRevWalk& walk) const
+{
+    foreach (const QGitOId &oid, m_pushed)
+    {
+        qGitThrow(walk.push(oid));
+    }
+    foreach (const QGitOId &oid, m_hidden)
+    {
+        qGitThrow(walk.hide(oid));
+    }
+}
+
+QGitOId QGitRevSpec::resolve(const QString& revision)
+{
+    QHash<QString, QGitOId>::const_iterator it = m_resolved.constFind(revision);
+    if (it != m_resolved.constEnd())
+    {
+        return it.value();
+    }
+
+    const QGitOId oid = resolveUncached(revision.toUtf8());
+    m_resolved.insert(revision, oid);
+    return oid;
+}
+
+void QGitRevSpec::clear()
+{
+    m_pushed.clear();
+    m_hidden.clear();
+}
+
+void QGitRevSpec::clearCache()
+{
+    m_refsLoaded = false;
+    m_refs.clear();
+    m_resolved.clear();
+    m_mergeBases.clear();
+}
+
+QGitOId QGitRevSpec::resolveUncached(const QByteArray& revision)
+{
+    ObjectGuard object;
+
+    git_oid oid;
+    if (isPlainName(revision) && lookupReference(revision, &oid))
+    {
+        qGitThrow(git_object_lookup(&object.object, m_repo.data(), &oid, GIT_OBJ_ANY));
+    }
+    else
+    {
+        qGitThrow(git_revparse_single(&object.object, m_repo.data(), revision.constData()));
+    }
+
+    ObjectGuard commit;
+    qGitThrow(git_object_peel(&commit.object, object.object, GIT_OBJ_COMMIT));
+    return QGitOId(git_object_id(commit.object));
+}
+
+bool QGitRevSpec::lookupReference(const QByteArray& name, git_oid *oid)
+{
+    if (!m_refsLoaded)
+    {
+        // one listing instead of probing every rule of every name on disk
+        git_strarray refs;
+        qGitThrow(git_reference_list(&refs, m_repo.data(), GIT_REF_LISTALL));
+        for (size_t i = 0; i < refs.count; ++i)
+        {
+            m_refs.insert(QByteArray(refs.strings[i]));
+        }
+        git_strarray_free(&refs);
+        m_refsLoaded = true;
+    }
+
+    const QString shortName = QString::fromUtf8(name);
+    for (size_t i = 0; i < sizeof(RefRules) / sizeof(RefRules[0]); ++i)
+    {
+        const QByteArray refName = QString::fromLatin1(RefRules[i]).arg(shortName).toUtf8();
+        if (m_refs.contains(refName))
+        {
+            qGitThrow(git_reference_name_to_id(oid, m_repo.data(), refName.constData()));
+            return true;
+        }
+    }
+
+    // HEAD, FETCH_HEAD and object ids are left to git_revparse_single
+    return false;
+}
+
+QList<QGitOId> QGitRevSpec::mergeBases(const QGitOId& a, const QGitOId& b)
+{
+    const QByteArray key = a.format() + b.format();
+    QHash<QByteArray, QList<QGitOId> >::const_iterator it = m_mergeBases.constFind(key);
+    if (it != m_mergeBases.constEnd())
+    {
+        return it.value();
+    }
+
+    QGitCommitGraph graph(m_repo);
+    graph.open();
+
+    QList<QGitOId> tips;
+    tips << b;
+    const QList<QGitOId> bases = QGitAheadBehind::compute(m_repo, a, tips, &graph).mergeBases(0);
+    m_mergeBases.insert(key, bases);
+    return bases;
+}
+
+} // namespace LibQGit2
@@ -0,0 +1,134 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_REVSPEC_H
+#define LIBQGIT2_REVSPEC_H
+
+#include "../libqgit2_export.h"
+
+#include "qgitrepository.h"
+#include "qgitoid.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+
+#include <git2/oid.h>
+
+namespace LibQGit2
+{
+    class QGitRevWalk;
+
+    /**
+     * @brief Parser and resolver for git revision range expressions.
+     *
+     * An expression is a whitespace separated list of terms:
+     * @li "B" starts the walk at B;
+     * @li "^C" leaves C and its ancestors out;
+     * @li "A..B" is "^A B";
+     * @li "A...B" is "A B" minus the merge bases of A and B.
+     *
+     * An empty side of ".." or "..." means HEAD. Single revisions accept
+     * anything git_revparse_single does, such as "HEAD~2", "v1.0^{}",
+     * "@{1}" or "master@{2}", and are peeled to commits.
+     *
+     * Plain reference names are looked up in the list of references of the
+     * repository, which is read once; only the matching reference is then
+     * resolved. Every resolved revision is cached for the life of the
+     * object, so a QGitRevSpec kept next to a walk resolves each name once.
+     * Call clearCache() to see references that moved since.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_REVWALK_EXPORT QGitRevSpec
+    {
+        public:
+            explicit QGitRevSpec(const QGitRepository& repository);
+
+            ~QGitRevSpec();
+
+            /**
+             * Parse and resolve expression, adding to the terms parsed so far.
+             * Nothing is added if any term of expression fails.
+             * @throws QGitException on a syntax error or an unknown revision
+             */
+            void parse(const QString& expression);
+
+            /**
+             * Parse every expression of the list; nothing is added if any of
+             * them fails.
+             * @throws QGitException
+             */
+            void parse(const QStringList& expressions);
+
+            /**
+             * Commits to start the walk at.
+             */
+            QList<QGitOId> pushed() const;
+
+            /**
+             * Commits left out of the walk, with their ancestors.
+             */
+            QList<QGitOId> hidden() const;
+
+            /**
+             * Push and hide the parsed commits on walk.
+             * @throws QGitException
+             */
+            void apply(QGitRevWalk& walk) const;
+
+            /**
+             * Resolve a single revision to a commit.
+             * @throws QGitException
+             */
+            QGitOId resolve(const QString& revision);
+
+            /**
+             * Forget the parsed terms; resolved revisions stay cached.
+             */
+            void clear();
+
+            /**
+             * Forget the resolved revisions and the list of references.
+             */
+            void clearCache();
+
+        private:
+            void parseInto(const QString& expression, QList<QGitOId>& pushed, QList<QGitOId>& hidden);
+            QGitOId resolveUncached(const QByteArray& revision);
+            bool lookupReference(const QByteArray& name, git_oid *oid);
+            QList<QGitOId> mergeBases(const QGitOId& a, const QGitOId& b);
+
+            QGitRepository m_repo;
+            QList<QGitOId> m_pushed;
+            QList<QGitOId> m_hidden;
+
+            bool m_refsLoaded;
+            QSet<QByteArray> m_refs;
+            QHash<QString, QGitOId> m_resolved;
+            QHash<QByteArray, QList<QGitOId> > m_mergeBases;
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_REVSPEC_H
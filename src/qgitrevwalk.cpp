@@ -20,8 +20,11 @@
 #include "qgitrevwalk.h"
 
 #include "qgitcommit.h"
+#include "qgitcommitbatch.h"
+#include "qgitexception.h"
 #include "qgitrepository.h"
 
+#include <git2/commit.h>
 #include <git2/revwalk.h>
 #include <git2/errors.h>
 
@@ -53,6 +56,11 @@ int QGitRevWalk::push(const QGitCommit& commit) const
     return git_revwalk_push(m_revWalk, commit.oid().data());
 }
 
+int QGitRevWalk::push(const QGitOId& oid) const
+{
+    return git_revwalk_push(m_revWalk, oid.constData());
+}
+
 int QGitRevWalk::hide(const QGitOId& oid) const
 {
     return git_revwalk_hide(m_revWalk, oid.constData());
@@ -78,6 +86,31 @@ bool QGitRevWalk::next(QGitCommit & commit)
     return !commit.isNull();
 }
 
+int QGitRevWalk::next(QGitCommitBatch & batch, int maxCount)
+{
+    batch.clear();
+
+    git_repository *repo = git_revwalk_repository(m_revWalk);
+    git_oid oid;
+    while (batch.count() < maxCount)
+    {
+        int err = git_revwalk_next(&oid, m_revWalk);
+        if (err == GIT_ITEROVER)
+        {
+            break;
+        }
+        qGitThrow(err);
+
+        // the walk hands out full ids, so the prefix lookup is not needed
+        git_commit *commit = NULL;
+        qGitThrow(git_commit_lookup(&commit, repo, &oid));
+        batch.append(commit);
+        git_commit_free(commit);
+    }
+
+    return batch.count();
+}
+
 void QGitRevWalk::setSorting(SortModes sortMode)
 {
     // wrap c defines
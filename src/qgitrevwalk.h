@@ -29,6 +29,7 @@ namespace LibQGit2
     class QGitRepository;
     class QGitOId;
     class QGitCommit;
+    class QGitCommitBatch;
 
     /**
       * @brief Wrapper class for git_revwalk.
@@ -81,6 +82,13 @@ namespace LibQGit2
              */
             int push(const QGitCommit& commit) const;
 
+            /**
+             * Mark a commit to start traversal from, by id.
+             *
+             * @param oid the id of the commit to start from.
+             */
+            int push(const QGitOId& oid) const;
+
             /**
              * Mark a commit (and its ancestors) uninteresting for the output.
              * @param commit the commit that will be ignored during the traversal
@@ -100,6 +108,17 @@ namespace LibQGit2
              */
             bool next(QGitCommit & commit);
 
+            /**
+             * Get the metadata of up to maxCount next commits of the traversal.
+             * The commits are read straight from the object database; no
+             * QGitCommit or QGitRepository wrapper is created for them.
+             * @param batch cleared, then filled with the commits
+             * @param maxCount maximum number of commits to read
+             * @return the number of commits read; 0 once the walk is over
+             * @throws QGitException
+             */
+            int next(QGitCommitBatch & batch, int maxCount);
+
             /**
              * Change the sorting mode when iterating through the
              * repository's contents.
@@ -20,6 +20,9 @@
 #include "qgitsignature.h"
 #include "qgitexception.h"
 
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+
 #include <git2/signature.h>
 
 namespace LibQGit2
@@ -68,18 +71,40 @@ const git_signature* QGitSignatureBuilder::data() const
     return d;
 }
 
+struct QGitSignature::Decoded
+{
+    enum Field
+    {
+        Name        = 0x1,
+        Email       = 0x2,
+        When        = 0x4
+    };
+
+    Decoded() : fields(0) {}
+
+    // copies share the cache and may be read from several threads
+    QMutex mutex;
+    int fields;
+    QString name;
+    QString email;
+    QDateTime when;
+};
+
 QGitSignature::QGitSignature(const git_signature *signature)
     : d(signature)
+    , m_decoded(new Decoded)
 {
 }
 
 QGitSignature::QGitSignature(const QGitSignature& other)
     : d(other.data())
+    , m_decoded(other.m_decoded)
 {
 }
 
 QGitSignature::QGitSignature(const QGitSignatureBuilder& other)
     : d(other.data())
+    , m_decoded(new Decoded)
 {
 }
 
@@ -89,20 +114,36 @@ QGitSignature::~QGitSignature()
 
 QString QGitSignature::name() const
 {
-    return QString::fromUtf8(d->name);
+    QMutexLocker lock(&m_decoded->mutex);
+    if (!(m_decoded->fields & Decoded::Name))
+    {
+        m_decoded->name = QString::fromUtf8(d->name);
+        m_decoded->fields |= Decoded::Name;
+    }
+    return m_decoded->name;
 }
 
 QString QGitSignature::email() const
 {
-    return QString::fromUtf8(d->email);
+    QMutexLocker lock(&m_decoded->mutex);
+    if (!(m_decoded->fields & Decoded::Email))
+    {
+        m_decoded->email = QString::fromUtf8(d->email);
+        m_decoded->fields |= Decoded::Email;
+    }
+    return m_decoded->email;
 }
 
 QDateTime QGitSignature::when() const
 {
-    QDateTime dt;
-    dt.setTime_t(d->when.time);
-    dt.setUtcOffset(d->when.offset * 60);
-    return dt;
+    QMutexLocker lock(&m_decoded->mutex);
+    if (!(m_decoded->fields & Decoded::When))
+    {
+        m_decoded->when.setTime_t(d->when.time);
+        m_decoded->when.setUtcOffset(d->when.offset * 60);
+        m_decoded->fields |= Decoded::When;
+    }
+    return m_decoded->when;
 }
 
 const git_signature *QGitSignature::data() const
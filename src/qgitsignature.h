@@ -24,6 +24,7 @@
 
 #include <QtCore/QString>
 #include <QtCore/QDateTime>
+#include <QtCore/QSharedPointer>
 
 struct git_signature;
 
@@ -108,6 +109,9 @@ namespace LibQGit2
      * An instance of this class does not own the underlaying data structure, only a reference
      * (pointer) to it.
      *
+     * The name, email and time stamp are decoded on first use and kept; copies of a
+     * signature share them.
+     *
      * Use QGitSignatureBuilder to create new signatures.
      *
      * @ingroup LibQGit2
@@ -157,7 +161,10 @@ namespace LibQGit2
             const git_signature *data() const;
 
         private:
+            struct Decoded;
+
             const git_signature *d;
+            QSharedPointer<Decoded> m_decoded;
     };
 
     /**@}*/
@@ -0,0 +1,291 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitsimilaritycache.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QVector>
+
+#include <algorithm>
+
+#include <string.h>
+
+namespace LibQGit2
+{
+
+/**
+ * Content of a file reduced to the sorted hashes of its lines, each weighted
+ * by the number of bytes it covers.
+ */
+class QGitSimilaritySignature
+{
+public:
+    explicit QGitSimilaritySignature(const char *buffer, size_t length)
+        : total(0)
+    {
+        QVector<Span> spans;
+        const char *end = buffer + length;
+        const char *line = buffer;
+
+        while (line < end)
+        {
+            const char *eol = static_cast<const char*>(memchr(line, '\n', end - line));
+            const char *next = eol ? eol + 1 : end;
+
+            // FNV-1a over the line, including its newline
+            quint32 h = 2166136261u;
+            for (const char *p = line; p < next; ++p)
+            {
+                h ^= uchar(*p);
+                h *= 16777619u;
+            }
+
+            Span span;
+            span.hash = h;
+            span.weight = quint32(next - line);
+            spans.append(span);
+            line = next;
+        }
+
+        std::sort(spans.begin(), spans.end());
+
+        // merge identical lines
+        for (int i = 0; i < spans.size(); ++i)
+        {
+            if (!m_spans.isEmpty() && m_spans.last().hash == spans.at(i).hash)
+            {
+                m_spans.last().weight += spans.at(i).weight;
+            }
+            else
+            {
+                m_spans.append(spans.at(i));
+            }
+            total += spans.at(i).weight;
+        }
+        m_spans.squeeze();
+    }
+
+    int byteSize() const
+    {
+        return int(sizeof(*this)) + m_spans.size() * int(sizeof(Span));
+    }
+
+    struct Span
+    {
+        quint32 hash;
+        quint32 weight;
+
+        bool operator<(const Span &other) const
+        {
+            return hash < other.hash;
+        }
+    };
+
+    QVector<Span> m_spans;
+    quint64 total;
+};
+
+namespace
+{
+
+typedef QSharedPointer<QGitSimilaritySignature> SignaturePtr;
+
+bool hasOId(const git_diff_file *file)
+{
+    return (file->flags & GIT_DIFF_FLAG_VALID_OID) && !git_oid_iszero(&file->oid);
+}
+
+}
+
+extern "C" int similarityFileSignatureCallBack(void **out, const git_diff_file *file,
+                                               const char *fullpath, void *payload)
+{
+    SignaturePtr sig = static_cast<QGitSimilarityCache*>(payload)->fileSignature(file, fullpath);
+    if (sig.isNull())
+    {
+        return -1;
+    }
+
+    // libgit2 holds on to a reference until it calls the free callback
+    *out = new SignaturePtr(sig);
+    return 0;
+}
+
+extern "C" int similarityBufferSignatureCallBack(void **out, const git_diff_file *file,
+                                                 const char *buf, size_t buflen, void *payload)
+{
+    SignaturePtr sig = static_cast<QGitSimilarityCache*>(payload)->signature(file, buf, buflen);
+    *out = new SignaturePtr(sig);
+    return 0;
+}
+
+extern "C" void similarityFreeSignatureCallBack(void *sig, void *payload)
+{
+    delete static_cast<SignaturePtr*>(sig);
+}
+
+extern "C" int similarityCallBack(int *score, void *siga, void *sigb, void *payload)
+{
+    *score = QGitSimilarityCache::similarity(**static_cast<SignaturePtr*>(siga),
+                                             **static_cast<SignaturePtr*>(sigb));
+    return 0;
+}
+
+QGitSimilarityCache::QGitSimilarityCache(int maxBytes)
+    : m_cache(maxBytes)
+    , m_hits(0)
+    , m_misses(0)
+{
+    m_metric.file_signature = similarityFileSignatureCallBack;
+    m_metric.buffer_signature = similarityBufferSignatureCallBack;
+    m_metric.free_signature = similarityFreeSignatureCallBack;
+    m_metric.similarity = similarityCallBack;
+    m_metric.payload = this;
+}
+
+QGitSimilarityCache::~QGitSimilarityCache()
+{
+}
+
+void QGitSimilarityCache::setMaxBytes(int maxBytes)
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.setMaxCost(maxBytes);
+}
+
+int QGitSimilarityCache::maxBytes() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_cache.maxCost();
+}
+
+void QGitSimilarityCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.clear();
+}
+
+int QGitSimilarityCache::hits() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_hits;
+}
+
+int QGitSimilarityCache::misses() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_misses;
+}
+
+git_diff_similarity_metric* QGitSimilarityCache::metric()
+{
+    return &m_metric;
+}
+
+QGitSimilarityCache::SignaturePtr QGitSimilarityCache::lookup(const git_diff_file *file)
+{
+    QMutexLocker lock(&m_mutex);
+    SignaturePtr *cached = hasOId(file) ? m_cache.object(QGitOId(&file->oid)) : 0;
+    if (cached)
+    {
+        ++m_hits;
+        return *cached;
+    }
+
+    ++m_misses;
+    return SignaturePtr();
+}
+
+void QGitSimilarityCache::insert(const git_diff_file *file, const SignaturePtr &signature)
+{
+    if (!hasOId(file))
+    {
+        return;
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_cache.insert(QGitOId(&file->oid), new SignaturePtr(signature), signature->byteSize());
+}
+
+QGitSimilarityCache::SignaturePtr QGitSimilarityCache::signature(const git_diff_file *file,
+                                                                 const char *buffer, size_t length)
+{
+    SignaturePtr sig = lookup(file);
+    if (sig.isNull())
+    {
+        sig = SignaturePtr(new QGitSimilaritySignature(buffer, length));
+        insert(file, sig);
+    }
+    return sig;
+}
+
+QGitSimilarityCache::SignaturePtr QGitSimilarityCache::fileSignature(const git_diff_file *file,
+                                                                     const char *path)
+{
+    SignaturePtr sig = lookup(file);
+    if (sig.isNull())
+    {
+        QFile f(QFile::decodeName(path));
+        if (!f.open(QIODevice::ReadOnly))
+        {
+            return SignaturePtr();
+        }
+
+        QByteArray content = f.readAll();
+        sig = SignaturePtr(new QGitSimilaritySignature(content.constData(), content.size()));
+        insert(file, sig);
+    }
+    return sig;
+}
+
+int QGitSimilarityCache::similarity(const QGitSimilaritySignature &a, const QGitSimilaritySignature &b)
+{
+    if (a.total == 0 || b.total == 0)
+    {
+        return (a.total == b.total) ? 100 : 0;
+    }
+
+    // bytes covered by lines present in both files
+    quint64 common = 0;
+    int i = 0, j = 0;
+    while (i < a.m_spans.size() && j < b.m_spans.size())
+    {
+        const QGitSimilaritySignature::Span &sa = a.m_spans.at(i);
+        const QGitSimilaritySignature::Span &sb = b.m_spans.at(j);
+        if (sa.hash < sb.hash)
+        {
+            ++i;
+        }
+        else if (sb.hash < sa.hash)
+        {
+            ++j;
+        }
+        else
+        {
+            common += qMin(sa.weight, sb.weight);
+            ++i;
+            ++j;
+        }
+    }
+
+    return int((200 * common) / (a.total + b.total));
+}
+
+} // namespace LibQGit2
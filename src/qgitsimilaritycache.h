@@ -0,0 +1,108 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_SIMILARITYCACHE_H
+#define LIBQGIT2_SIMILARITYCACHE_H
+
+#include "../libqgit2_export.h"
+
+#include "qgitoid.h"
+
+#include <QtCore/QCache>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+
+#include <git2/diff.h>
+
+namespace LibQGit2
+{
+    class QGitSimilaritySignature;
+
+    /**
+     * @brief Bounded cache of blob similarity signatures used for rename and
+     * copy detection.
+     *
+     * Signatures are keyed by blob oid, so diffs of nearby commits that look at
+     * the same blobs only hash them once. Keep one cache per repository and hand
+     * it to every QGitDiff made on that repository; the cache is thread safe.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_DIFF_EXPORT QGitSimilarityCache
+    {
+        public:
+            /**
+             * @param maxBytes approximate memory budget of the cached signatures
+             */
+            explicit QGitSimilarityCache(int maxBytes = 16 * 1024 * 1024);
+
+            ~QGitSimilarityCache();
+
+            void setMaxBytes(int maxBytes);
+
+            int maxBytes() const;
+
+            /**
+             * Drop all cached signatures.
+             */
+            void clear();
+
+            /**
+             * Number of signature requests answered from the cache.
+             */
+            int hits() const;
+
+            /**
+             * Number of signature requests that had to hash the content.
+             */
+            int misses() const;
+
+            /**
+             * The similarity metric to pass to git_diff_find_similar(). It stays
+             * valid as long as the cache is alive.
+             */
+            git_diff_similarity_metric* metric();
+
+            // public so they can be called from the c callback code
+            QSharedPointer<QGitSimilaritySignature> signature(const git_diff_file *file,
+                                                               const char *buffer, size_t length);
+            QSharedPointer<QGitSimilaritySignature> fileSignature(const git_diff_file *file,
+                                                                   const char *path);
+            static int similarity(const QGitSimilaritySignature &a, const QGitSimilaritySignature &b);
+
+        private:
+            Q_DISABLE_COPY(QGitSimilarityCache)
+
+            typedef QSharedPointer<QGitSimilaritySignature> SignaturePtr;
+
+            SignaturePtr lookup(const git_diff_file *file);
+            void insert(const git_diff_file *file, const SignaturePtr &signature);
+
+            mutable QMutex m_mutex;
+            QCache<QGitOId, SignaturePtr> m_cache;
+            git_diff_similarity_metric m_metric;
+            int m_hits;
+            int m_misses;
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_SIMILARITYCACHE_H
@@ -0,0 +1,347 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitstatusengine.h"
+
+#include "qgitcommit.h"
+#include "qgitindex.h"
+#include "qgittree.h"
+#include "qgitexception.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+#include <git2/diff.h>
+#include <git2/errors.h>
+#include <git2/index.h>
+#include <git2/odb.h>
+
+#include <algorithm>
+
+#include <stdlib.h>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace LibQGit2
+{
+
+namespace
+{
+
+/**
+ * Hash the work tree file at fullPath the way git stores it: a symbolic
+ * link is hashed from its target path, not from the file it points to.
+ */
+void hashWorkTreeFile(git_oid *oid, const QByteArray &fullPath, unsigned int mode)
+{
+#ifdef Q_OS_UNIX
+    if (mode == GIT_FILEMODE_LINK)
+    {
+        QByteArray target(256, Qt::Uninitialized);
+        ssize_t length;
+        while ((length = ::readlink(fullPath.constData(), target.data(), target.size())) == target.size())
+        {
+            target.resize(target.size() * 2);
+        }
+        if (length < 0)
+        {
+            giterr_set_str(GITERR_OS, "failed to read symbolic link");
+            qGitThrow(GIT_ERROR);
+        }
+        qGitThrow(git_odb_hash(oid, target.constData(), size_t(length), GIT_OBJ_BLOB));
+        return;
+    }
+#else
+    Q_UNUSED(mode);
+#endif
+    qGitThrow(git_odb_hashfile(oid, fullPath.constData(), GIT_OBJ_BLOB));
+}
+
+}
+
+QGitStatusEngine::QGitStatusEngine(const QGitRepository& repository)
+    : m_repo(repository)
+    , m_workDir(QFile::encodeName(repository.workDirPath()))
+    , m_hashed(0)
+    , m_stagedIndexSize(-1)
+{
+}
+
+QGitStatusEngine::~QGitStatusEngine()
+{
+}
+
+int QGitStatusEngine::hashedFiles() const
+{
+    return m_hashed;
+}
+
+void QGitStatusEngine::invalidate()
+{
+    m_stat.clear();
+    m_staged.clear();
+    m_stagedHead = QGitOId();
+    m_stagedIndexSize = -1;
+}
+
+bool QGitStatusEngine::statFile(const QByteArray& path, StatEntry& entry) const
+{
+    QByteArray fullPath = m_workDir + path;
+
+#ifdef Q_OS_UNIX
+    struct stat st;
+    if (::lstat(fullPath.constData(), &st) != 0)
+    {
+        return false;
+    }
+    entry.mtime = st.st_mtime;
+    entry.size = st.st_size;
+    entry.inode = st.st_ino;
+    if (S_ISLNK(st.st_mode))
+    {
+        entry.mode = GIT_FILEMODE_LINK;
+    }
+    else if (S_ISDIR(st.st_mode))
+    {
+        entry.mode = GIT_FILEMODE_COMMIT;
+    }
+    else
+    {
+        entry.mode = (st.st_mode & S_IXUSR) ? GIT_FILEMODE_BLOB_EXECUTABLE : GIT_FILEMODE_BLOB;
+    }
+#else
+    QFileInfo info(QFile::decodeName(fullPath));
+    if (!info.exists())
+    {
+        return false;
+    }
+    entry.mtime = info.lastModified().toTime_t();
+    entry.size = info.size();
+    entry.inode = 0;
+    entry.mode = info.isDir() ? GIT_FILEMODE_COMMIT : 0;     // no exec bit or symbolic links to compare
+#endif
+
+    return true;
+}
+
+QVector<QGitStatusEngine::Change> QGitStatusEngine::refresh()
+{
+    m_hashed = 0;
+
+    QGitIndex index = m_repo.index();
+    index.read();
+
+    QHash<QByteArray, Status> status;
+    refreshStaged(index, status);
+
+    // a file modified in the same second the index was written may still have
+    // the same mtime as in the index, so the stat data can not be trusted then
+    qint64 indexTime = QFileInfo(m_repo.path() + "index").lastModified().toTime_t();
+    qint64 now = QDateTime::currentDateTime().toTime_t();
+
+    size_t count = git_index_entrycount(index.data());
+    QHash<QByteArray, StatEntry> stat;
+    stat.reserve(int(count));
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const git_index_entry *e = git_index_get_byindex(index.data(), i);
+        QByteArray path(e->path);
+
+        if (git_index_entry_stage(e) > 0)
+        {
+            status[path] |= Conflicted;
+            continue;
+        }
+
+        StatEntry current;
+        if (!statFile(path, current))
+        {
+            status[path] |= WorkTreeDeleted;
+            continue;
+        }
+        git_oid_cpy(&current.indexOid, &e->oid);
+
+        QHash<QByteArray, StatEntry>::const_iterator cached = m_stat.constFind(path);
+        if (current.mode == GIT_FILEMODE_COMMIT || e->mode == GIT_FILEMODE_COMMIT)
+        {
+            // a submodule, or a directory where the index has a file: there
+            // is no content to hash, only a change of the mode is reported
+            current.modified = false;
+        }
+        else if (cached != m_stat.constEnd()
+                && cached->mtime == current.mtime
+                && cached->size == current.size
+                && cached->inode == current.inode
+                && current.mtime < now
+                && git_oid_cmp(&cached->indexOid, &e->oid) == 0)
+        {
+            // nothing moved since we last looked at the file
+            current.modified = cached->modified;
+        }
+        else if (current.mtime == qint64(e->mtime.seconds)
+                 && current.size == qint64(e->file_size)
+                 && current.mtime < indexTime)
+        {
+            // the file still matches what the index recorded for it
+            current.modified = false;
+        }
+        else
+        {
+            git_oid oid;
+            hashWorkTreeFile(&oid, m_workDir + path, current.mode);
+            ++m_hashed;
+            current.modified = git_oid_cmp(&oid, &e->oid) != 0;
+        }
+
+        // a change of the exec bit alone, or between a file and a link
+        const bool modeChanged = current.mode != 0 && current.mode != e->mode;
+
+        if (current.modified || modeChanged)
+        {
+            status[path] |= WorkTreeModified;
+        }
+
+        // only cache what can not change within the current second anymore
+        if (current.mtime < now)
+        {
+            stat.insert(path, current);
+        }
+    }
+
+    m_stat.swap(stat);
+
+    QList<QByteArray> paths = status.keys();
+    std::sort(paths.begin(), paths.end());
+
+    QVector<Change> changes;
+    changes.reserve(paths.size());
+    foreach (const QByteArray &path, paths)
+    {
+        Change change;
+        change.path = path;
+        change.status = status.value(path);
+        changes.append(change);
+    }
+    return changes;
+}
+
+void QGitStatusEngine::refreshStaged(const QGitIndex& index, QHash<QByteArray, Status>& status)
+{
+    QGitOId head;
+    if (!m_repo.isHeadOrphan())
+    {
+        head = m_repo.head().oid();
+    }
+
+    QFileInfo indexInfo(m_repo.path() + "index");
+
+    if (head != m_stagedHead
+            || indexInfo.lastModified() != m_stagedIndexTime
+            || indexInfo.size() != m_stagedIndexSize)
+    {
+        QGitTree tree;
+        if (head.isValid())
+        {
+            tree = m_repo.lookupCommit(head).tree();
+        }
+
+        git_diff_list *diff = NULL;
+        qGitThrow(git_diff_tree_to_index(&diff, m_repo.data(), tree.data(), index.data(), NULL));
+
+        m_staged.clear();
+        size_t count = git_diff_num_deltas(diff);
+        for (size_t i = 0; i < count; ++i)
+        {
+            // only the delta is needed, the patch is never generated
+            const git_diff_delta *delta = NULL;
+            const int err = git_diff_get_patch(NULL, &delta, diff, i);
+            if (err < 0)
+            {
+                git_diff_list_free(diff);
+                qGitThrow(err);
+            }
+            if (delta == NULL)
+            {
+                continue;
+            }
+
+            Status s;
+            switch (delta->status)
+            {
+            case GIT_DELTA_ADDED:
+                s = IndexNew;
+                break;
+            case GIT_DELTA_DELETED:
+                s = IndexDeleted;
+                break;
+            default:
+                s = IndexModified;
+                break;
+            }
+            m_staged.insert(QByteArray(delta->new_file.path), s);
+        }
+        git_diff_list_free(diff);
+
+        m_stagedHead = head;
+        m_stagedIndexTime = indexInfo.lastModified();
+        m_stagedIndexSize = indexInfo.size();
+    }
+
+    for (QHash<QByteArray, Status>::const_iterator it = m_staged.constBegin(); it != m_staged.constEnd(); ++it)
+    {
+        status[it.key()] |= it.value();
+    }
+}
+
+QByteArray QGitStatusEngine::patch(const QByteArray& path) const
+{
+    QGitIndex index = m_repo.index();
+
+    git_diff_options opts = GIT_DIFF_OPTIONS_INIT;
+    char *paths[] = { const_cast<char*>(path.constData()) };
+    opts.pathspec.strings = paths;
+    opts.pathspec.count = 1;
+
+    git_diff_list *diff = NULL;
+    qGitThrow(git_diff_index_to_workdir(&diff, m_repo.data(), index.data(), &opts));
+
+    QByteArray out;
+    size_t count = git_diff_num_deltas(diff);
+    for (size_t i = 0; i < count; ++i)
+    {
+        git_diff_patch *patch = NULL;
+        char *text = NULL;
+        if (git_diff_get_patch(&patch, NULL, diff, i) == 0 && patch != NULL
+                && git_diff_patch_to_str(&text, patch) == 0)
+        {
+            out.append(text);
+            free(text);
+        }
+        git_diff_patch_free(patch);
+    }
+
+    git_diff_list_free(diff);
+    return out;
+}
+
+} // namespace LibQGit2
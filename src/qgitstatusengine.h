@@ -0,0 +1,135 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_STATUSENGINE_H
+#define LIBQGIT2_STATUSENGINE_H
+
+#include "../libqgit2_export.h"
+
+#include "qgitrepository.h"
+#include "qgitoid.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDateTime>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+#include <git2/oid.h>
+
+namespace LibQGit2
+{
+    /**
+     * @brief Incremental working directory status.
+     *
+     * The engine remembers the stat data (mtime, size, inode) it saw for every
+     * index entry. On each refresh() only files whose stat data changed since
+     * the previous call are hashed again; the staged changes are only diffed
+     * again when the index or HEAD moved. No patch text is generated unless
+     * patch() is called.
+     *
+     * Untracked files are not reported.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_INDEX_EXPORT QGitStatusEngine
+    {
+        public:
+            enum StatusFlag
+            {
+                Unmodified          = 0x00,
+                IndexNew            = 0x01, //!< added to the index, not in HEAD
+                IndexModified       = 0x02, //!< staged modification
+                IndexDeleted        = 0x04, //!< removed from the index, still in HEAD
+                WorkTreeModified    = 0x08, //!< working file differs from the index
+                WorkTreeDeleted     = 0x10, //!< working file is missing
+                Conflicted          = 0x20  //!< the index has unmerged entries for the path
+            };
+            Q_DECLARE_FLAGS(Status, StatusFlag)
+
+            /**
+             * One dirty path of the repository.
+             */
+            struct Change
+            {
+                QByteArray path;
+                Status status;
+            };
+
+            explicit QGitStatusEngine(const QGitRepository& repository);
+
+            ~QGitStatusEngine();
+
+            /**
+             * Bring the status up to date with the working directory.
+             *
+             * @return every path that currently differs from HEAD or the index
+             * @throws QGitException
+             */
+            QVector<Change> refresh();
+
+            /**
+             * Number of files that had to be hashed during the last refresh().
+             */
+            int hashedFiles() const;
+
+            /**
+             * Forget all cached stat data; the next refresh() hashes everything again.
+             */
+            void invalidate();
+
+            /**
+             * Patch between the index and the working directory for one path.
+             *
+             * @throws QGitException
+             */
+            QByteArray patch(const QByteArray& path) const;
+
+        private:
+            struct StatEntry
+            {
+                qint64 mtime;
+                qint64 size;
+                quint64 inode;
+                unsigned int mode;      // git file mode of the work tree file, 0 if unknown
+                git_oid indexOid;
+                bool modified;          // content only, the mode is compared on every refresh
+            };
+
+            void refreshStaged(const QGitIndex& index, QHash<QByteArray, Status>& status);
+            bool statFile(const QByteArray& path, StatEntry& entry) const;
+
+            QGitRepository m_repo;
+            QByteArray m_workDir;
+            QHash<QByteArray, StatEntry> m_stat;
+            int m_hashed;
+
+            // staged changes, valid as long as HEAD and the index file do not move
+            QHash<QByteArray, Status> m_staged;
+            QGitOId m_stagedHead;
+            QDateTime m_stagedIndexTime;
+            qint64 m_stagedIndexSize;
+    };
+
+    Q_DECLARE_OPERATORS_FOR_FLAGS(QGitStatusEngine::Status)
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_STATUSENGINE_H
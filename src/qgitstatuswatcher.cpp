@@ -0,0 +1,432 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgitstatuswatcher.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QFileSystemWatcher>
+#include <QtCore/QSocketNotifier>
+
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+namespace LibQGit2
+{
+
+namespace
+{
+
+#ifdef Q_OS_LINUX
+const uint32_t WatchMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE
+                         | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB;
+#endif
+
+QString joinPath(const QString &dir, const QString &name)
+{
+    if (dir.isEmpty())
+    {
+        return name;
+    }
+    return dir + QLatin1Char('/') + name;
+}
+
+QStringList sorted(const QSet<QString> &set)
+{
+    QStringList list = set.toList();
+    std::sort(list.begin(), list.end());
+    return list;
+}
+
+}
+
+QGitStatusWatcher::QGitStatusWatcher(const QGitRepository& repository, QObject *parent)
+    : QObject(parent)
+    , m_repo(repository)
+    , m_workDir(repository.workDirPath())
+    , m_gitDir(repository.path())
+    , m_indexDirty(false)
+    , m_overflow(false)
+    , m_complete(true)
+    , m_inotifyFd(-1)
+    , m_notifier(0)
+    , m_fallback(0)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(100);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+QGitStatusWatcher::~QGitStatusWatcher()
+{
+    stop();
+}
+
+void QGitStatusWatcher::setDebounceInterval(int msec)
+{
+    m_timer.setInterval(msec);
+}
+
+int QGitStatusWatcher::debounceInterval() const
+{
+    return m_timer.interval();
+}
+
+bool QGitStatusWatcher::isUsingInotify() const
+{
+    return m_inotifyFd >= 0;
+}
+
+bool QGitStatusWatcher::isComplete() const
+{
+    return m_complete;
+}
+
+bool QGitStatusWatcher::start()
+{
+    stop();
+
+#ifdef Q_OS_LINUX
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd >= 0)
+    {
+        m_notifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+        connect(m_notifier, SIGNAL(activated(int)), this, SLOT(readInotifyEvents()));
+    }
+#endif
+
+    if (m_inotifyFd < 0)
+    {
+        m_fallback = new QFileSystemWatcher(this);
+        connect(m_fallback, SIGNAL(directoryChanged(QString)), this, SLOT(directoryChanged(QString)));
+        connect(m_fallback, SIGNAL(fileChanged(QString)), this, SLOT(fileChanged(QString)));
+    }
+
+    if (!m_workDir.isEmpty())
+    {
+        addDirectory(WorkTree, QString(), true);
+    }
+    addDirectory(GitDir, QString(), false);
+    addDirectory(Refs, QLatin1String("refs"), true);
+
+    if (m_fallback)
+    {
+        // QFileSystemWatcher only reports the directory, so watch the
+        // interesting files of the git directory one by one
+        QStringList files;
+        files << "HEAD" << "index" << "packed-refs";
+        foreach (const QString &file, files)
+        {
+            QString path = m_gitDir + file;
+            if (QFile::exists(path))
+            {
+                m_fallback->addPath(path);
+            }
+        }
+    }
+
+    return !m_watches.isEmpty() || !m_fallbackWatches.isEmpty();
+}
+
+void QGitStatusWatcher::stop()
+{
+    m_timer.stop();
+
+    delete m_notifier;
+    m_notifier = 0;
+
+#ifdef Q_OS_LINUX
+    if (m_inotifyFd >= 0)
+    {
+        // closing the descriptor drops all of its watches
+        ::close(m_inotifyFd);
+    }
+#endif
+    m_inotifyFd = -1;
+    m_watches.clear();
+
+    delete m_fallback;
+    m_fallback = 0;
+    m_fallbackWatches.clear();
+
+    m_dirtyPaths.clear();
+    m_movedRefs.clear();
+    m_indexDirty = false;
+    m_overflow = false;
+    m_complete = true;
+}
+
+void QGitStatusWatcher::addWatch(WatchKind kind, const QString& relativePath)
+{
+    Watch watch;
+    watch.kind = kind;
+    watch.path = relativePath;
+
+    QString absolutePath = (kind == WorkTree ? m_workDir : m_gitDir) + relativePath;
+
+#ifdef Q_OS_LINUX
+    if (m_inotifyFd >= 0)
+    {
+        int wd = inotify_add_watch(m_inotifyFd, QFile::encodeName(absolutePath), WatchMask);
+        if (wd >= 0)
+        {
+            m_watches.insert(wd, watch);
+        }
+        else if (errno != ENOENT)
+        {
+            // out of watches (ENOSPC) or not readable: changes below the
+            // directory would go unnoticed, so consumers have to rescan
+            m_complete = false;
+            m_overflow = true;
+            schedule();
+        }
+        return;
+    }
+#endif
+
+    if (m_fallback && !m_fallbackWatches.contains(absolutePath))
+    {
+        m_fallback->addPath(absolutePath);
+        m_fallbackWatches.insert(absolutePath, watch);
+    }
+}
+
+void QGitStatusWatcher::addDirectory(WatchKind kind, const QString& relativePath, bool recursive)
+{
+    addWatch(kind, relativePath);
+    if (!recursive)
+    {
+        return;
+    }
+
+    QDir dir((kind == WorkTree ? m_workDir : m_gitDir) + relativePath);
+    QStringList subDirs = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden | QDir::NoSymLinks);
+    foreach (const QString &subDir, subDirs)
+    {
+        // the git directory is watched separately
+        if (kind == WorkTree && subDir == QLatin1String(".git"))
+        {
+            continue;
+        }
+        addDirectory(kind, joinPath(relativePath, subDir), true);
+    }
+}
+
+void QGitStatusWatcher::gitDirEvent(const QString& name)
+{
+    if (name == QLatin1String("index"))
+    {
+        m_indexDirty = true;
+    }
+    else if (name == QLatin1String("HEAD") || name == QLatin1String("packed-refs")
+             || name.endsWith(QLatin1String("_HEAD")))
+    {
+        m_movedRefs.insert(name);
+    }
+    else
+    {
+        return;
+    }
+    schedule();
+}
+
+void QGitStatusWatcher::schedule()
+{
+    // the window starts with the first event, so a steady stream of events
+    // can not delay the report forever
+    if (!m_timer.isActive())
+    {
+        m_timer.start();
+    }
+}
+
+void QGitStatusWatcher::readInotifyEvents()
+{
+#ifdef Q_OS_LINUX
+    char buffer[64 * 1024] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+    for (;;)
+    {
+        ssize_t len = ::read(m_inotifyFd, buffer, sizeof(buffer));
+        if (len <= 0)
+        {
+            // EAGAIN: the queue is drained
+            break;
+        }
+
+        for (char *p = buffer; p < buffer + len; )
+        {
+            const struct inotify_event *ev = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW)
+            {
+                m_overflow = true;
+                schedule();
+                continue;
+            }
+
+            QHash<int, Watch>::const_iterator it = m_watches.constFind(ev->wd);
+            if (it == m_watches.constEnd())
+            {
+                continue;
+            }
+
+            if (ev->mask & IN_IGNORED)
+            {
+                // the watched directory is gone
+                m_watches.remove(ev->wd);
+                continue;
+            }
+
+            Watch watch = it.value();
+            QString name = ev->len ? QFile::decodeName(ev->name) : QString();
+            QString path = joinPath(watch.path, name);
+            bool isDir = (ev->mask & IN_ISDIR) != 0;
+            bool appeared = (ev->mask & (IN_CREATE | IN_MOVED_TO)) != 0;
+
+            switch (watch.kind)
+            {
+            case WorkTree:
+                if (isDir && name == QLatin1String(".git"))
+                {
+                    break;
+                }
+                if (isDir && appeared)
+                {
+                    // files may have been written before the watch was in place
+                    addDirectory(WorkTree, path, true);
+                    QDirIterator files(m_workDir + path, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+                    while (files.hasNext())
+                    {
+                        m_dirtyPaths.insert(files.next().mid(m_workDir.size()));
+                    }
+                }
+                else if (isDir)
+                {
+                    m_dirtyPaths.insert(path + QLatin1Char('/'));
+                }
+                else
+                {
+                    m_dirtyPaths.insert(path);
+                }
+                schedule();
+                break;
+
+            case GitDir:
+                if (!isDir)
+                {
+                    gitDirEvent(name);
+                }
+                break;
+
+            case Refs:
+                if (isDir && appeared)
+                {
+                    addDirectory(Refs, path, true);
+                }
+                else if (!isDir && !name.endsWith(QLatin1String(".lock")))
+                {
+                    m_movedRefs.insert(path);
+                    schedule();
+                }
+                break;
+            }
+        }
+    }
+#endif
+}
+
+void QGitStatusWatcher::directoryChanged(const QString& path)
+{
+    QHash<QString, Watch>::const_iterator it = m_fallbackWatches.constFind(path);
+    if (it == m_fallbackWatches.constEnd())
+    {
+        return;
+    }
+
+    Watch watch = it.value();
+    QString dir = watch.path.isEmpty() ? QString() : watch.path + QLatin1Char('/');
+
+    switch (watch.kind)
+    {
+    case WorkTree:
+        m_dirtyPaths.insert(dir.isEmpty() ? QString("./") : dir);
+        addDirectory(WorkTree, watch.path, true);
+        break;
+
+    case GitDir:
+        // HEAD, index and packed-refs are watched as files
+        return;
+
+    case Refs:
+        m_movedRefs.insert(dir);
+        addDirectory(Refs, watch.path, true);
+        break;
+    }
+    schedule();
+}
+
+void QGitStatusWatcher::fileChanged(const QString& path)
+{
+    // files replaced through a rename drop out of the watcher
+    if (QFile::exists(path) && !m_fallback->files().contains(path))
+    {
+        m_fallback->addPath(path);
+    }
+    gitDirEvent(QFileInfo(path).fileName());
+}
+
+void QGitStatusWatcher::flush()
+{
+    if (m_overflow)
+    {
+        m_overflow = false;
+        emit rescanRequired();
+    }
+
+    if (!m_dirtyPaths.isEmpty())
+    {
+        QStringList paths = sorted(m_dirtyPaths);
+        m_dirtyPaths.clear();
+        emit workTreeChanged(paths);
+    }
+
+    if (m_indexDirty)
+    {
+        m_indexDirty = false;
+        emit indexChanged();
+    }
+
+    if (!m_movedRefs.isEmpty())
+    {
+        QStringList refs = sorted(m_movedRefs);
+        m_movedRefs.clear();
+        emit refsChanged(refs);
+    }
+}
+
+} // namespace LibQGit2
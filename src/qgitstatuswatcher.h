@@ -0,0 +1,161 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_STATUSWATCHER_H
+#define LIBQGIT2_STATUSWATCHER_H
+
+#include "../libqgit2_export.h"
+
+#include "qgitrepository.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+#include <QtCore/QTimer>
+
+class QFileSystemWatcher;
+class QSocketNotifier;
+
+namespace LibQGit2
+{
+    /**
+     * @brief Watches a repository and reports what changed in it.
+     *
+     * On Linux the watcher uses inotify and reports the exact files that
+     * changed. Elsewhere it falls back to QFileSystemWatcher, which can only
+     * tell which directory changed; those are reported with a trailing '/'.
+     *
+     * Events are coalesced over the debounce interval, so a burst of writes
+     * (a checkout, a build) produces a single set of signals.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_INDEX_EXPORT QGitStatusWatcher : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        explicit QGitStatusWatcher(const QGitRepository& repository, QObject *parent = 0);
+        ~QGitStatusWatcher();
+
+        /**
+         * Time, in milliseconds, events are collected before they are reported.
+         * Defaults to 100.
+         */
+        void setDebounceInterval(int msec);
+        int debounceInterval() const;
+
+        /**
+         * Start watching. Walks the working tree once to register its directories.
+         * @return false if nothing could be watched
+         */
+        bool start();
+
+        /**
+         * Stop watching and drop pending events.
+         */
+        void stop();
+
+        /**
+         * Return true if the precise inotify backend is in use.
+         */
+        bool isUsingInotify() const;
+
+        /**
+         * Return false if some directories could not be watched, e.g. because
+         * the inotify watch limit was reached. rescanRequired() is emitted
+         * when that happens; changes below those directories are not reported.
+         */
+        bool isComplete() const;
+
+    signals:
+        /**
+         * Files of the working tree were created, modified or removed.
+         * @param paths paths relative to the working directory
+         */
+        void workTreeChanged(const QStringList& paths);
+
+        /**
+         * The index file was rewritten.
+         */
+        void indexChanged();
+
+        /**
+         * References moved.
+         * @param refs names of the moved references, e.g. "HEAD" or "refs/heads/master";
+         * "packed-refs" if the packed references file changed
+         */
+        void refsChanged(const QStringList& refs);
+
+        /**
+         * Events were lost (the kernel queue overflowed) or a directory could
+         * not be watched; consumers should rescan the repository.
+         */
+        void rescanRequired();
+
+    private slots:
+        void readInotifyEvents();
+        void directoryChanged(const QString& path);
+        void fileChanged(const QString& path);
+        void flush();
+
+    private:
+        enum WatchKind
+        {
+            WorkTree,
+            GitDir,
+            Refs
+        };
+
+        struct Watch
+        {
+            WatchKind kind;
+            QString path;   // relative to the work tree, or to the git directory
+        };
+
+        void addDirectory(WatchKind kind, const QString& relativePath, bool recursive);
+        void addWatch(WatchKind kind, const QString& relativePath);
+        void gitDirEvent(const QString& name);
+        void schedule();
+
+        QGitRepository m_repo;
+        QString m_workDir;
+        QString m_gitDir;
+
+        QTimer m_timer;
+        QSet<QString> m_dirtyPaths;
+        QSet<QString> m_movedRefs;
+        bool m_indexDirty;
+        bool m_overflow;
+        bool m_complete;
+
+        int m_inotifyFd;
+        QSocketNotifier *m_notifier;
+        QHash<int, Watch> m_watches;
+
+        QFileSystemWatcher *m_fallback;
+        QHash<QString, Watch> m_fallbackWatches;
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_STATUSWATCHER_H
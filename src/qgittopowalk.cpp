@@ -0,0 +1,620 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgittopowalk.h"
+
+#include "qgitcommitgraph.h"
+#include "qgitexception.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRunnable>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
+
+#include <git2/commit.h>
+#include <git2/errors.h>
+#include <git2/repository.h>
+
+#include <string.h>
+
+namespace LibQGit2
+{
+
+namespace
+{
+
+const char CursorMagic[4] = { 'Q', 'T', 'W', 'C' };
+const quint32 CursorVersion = 1;
+
+/**
+ * Commits parsed by the workers. Every worker takes a commit from the
+ * pending list and puts back the parents nobody has seen yet, until the
+ * list is empty and no worker is busy. Protected by the mutex.
+ */
+struct ParseState
+{
+    struct Parsed
+    {
+        qint64 time;
+        QList<QGitOId> parents;
+    };
+
+    ParseState() : graph(0), busy(0) {}
+
+    const QGitCommitGraph *graph;
+    QMutex mutex;
+    QWaitCondition wake;
+    QList<QGitOId> pending;
+    QHash<QGitOId, int> index;
+    QVector<Parsed> parsed;
+    int busy;
+    QString error;
+
+    bool inGraph(const QGitOId &oid) const
+    {
+        return graph && graph->find(oid) != QGitCommitGraph::NotFound;
+    }
+};
+
+class ParseWorker : public QRunnable
+{
+public:
+    ParseWorker(ParseState *state, const QString &path)
+        : m_state(state), m_path(path)
+    {
+    }
+
+    void run()
+    {
+        // libgit2 repositories must not be shared between threads
+        git_repository *raw = 0;
+        int openError = git_repository_open(&raw, QFile::encodeName(m_path));
+        QGitRepository repo(raw, true);
+
+        for (;;)
+        {
+            QGitOId oid;
+            {
+                QMutexLocker lock(&m_state->mutex);
+                if (openError < 0 && m_state->error.isEmpty())
+                {
+                    m_state->error = lastError();
+                }
+                while (m_state->pending.isEmpty() && m_state->busy > 0 && m_state->error.isEmpty())
+                {
+                    m_state->wake.wait(&m_state->mutex);
+                }
+                if (m_state->pending.isEmpty() || !m_state->error.isEmpty())
+                {
+                    m_state->wake.wakeAll();
+                    return;
+                }
+                oid = m_state->pending.takeLast();
+                ++m_state->busy;
+            }
+
+            ParseState::Parsed parsed;
+            git_commit *commit = 0;
+            int err = git_commit_lookup(&commit, repo.data(), oid.constData());
+            if (err == 0)
+            {
+                parsed.time = git_commit_time(commit);
+                unsigned count = git_commit_parentcount(commit);
+                for (unsigned n = 0; n < count; ++n)
+                {
+                    parsed.parents.append(QGitOId(git_commit_parent_id(commit, n)));
+                }
+                git_commit_free(commit);
+            }
+
+            QMutexLocker lock(&m_state->mutex);
+            --m_state->busy;
+            if (err < 0)
+            {
+                m_state->error = lastError();
+                m_state->wake.wakeAll();
+                return;
+            }
+
+            m_state->parsed[m_state->index.value(oid)] = parsed;
+            foreach (const QGitOId &parent, parsed.parents)
+            {
+                if (!m_state->index.contains(parent) && !m_state->inGraph(parent))
+                {
+                    m_state->index.insert(parent, m_state->parsed.size());
+                    m_state->parsed.append(ParseState::Parsed());
+                    m_state->pending.append(parent);
+                    m_state->wake.wakeOne();
+                }
+            }
+            if (m_state->busy == 0 && m_state->pending.isEmpty())
+            {
+                m_state->wake.wakeAll();
+            }
+        }
+    }
+
+private:
+    static QString lastError()
+    {
+        const git_error *err = giterr_last();
+        return err ? QString::fromUtf8(err->message) : QString("could not read commit");
+    }
+
+    ParseState *m_state;
+    QString m_path;
+};
+
+}
+
+bool QGitTopoWalk::Entry::operator<(const Entry& other) const
+{
+    if (primary != other.primary)
+    {
+        return primary < other.primary;
+    }
+    if (secondary != other.secondary)
+    {
+        return secondary < other.secondary;
+    }
+    return node < other.node;
+}
+
+QGitTopoWalk::QGitTopoWalk(const QGitRepository& repository, const QGitCommitGraph *graph)
+    : m_repo(repository)
+    , m_graph(graph)
+    , m_order(TopologicalOrder)
+    , m_maxThreads(QThread::idealThreadCount())
+    , m_prepared(false)
+    , m_interesting(0)
+{
+}
+
+QGitTopoWalk::~QGitTopoWalk()
+{
+}
+
+void QGitTopoWalk::setOrder(Order order)
+{
+    m_order = order;
+    m_prepared = false;
+}
+
+void QGitTopoWalk::setMaxThreads(int count)
+{
+    m_maxThreads = qMax(1, count);
+}
+
+void QGitTopoWalk::push(const QGitOId& commit)
+{
+    m_pushed.append(commit);
+    m_prepared = false;
+}
+
+void QGitTopoWalk::hide(const QGitOId& commit)
+{
+    m_hidden.append(commit);
+    m_prepared = false;
+}
+
+void QGitTopoWalk::reset()
+{
+    m_pushed.clear();
+    m_hidden.clear();
+    m_resumeQueued.clear();
+    m_resumeReturned.clear();
+    m_prepared = false;
+}
+
+QByteArray QGitTopoWalk::cursor()
+{
+    if (!m_prepared)
+    {
+        prepare();
+    }
+
+    // the queue holds every commit seen but not walked yet
+    QList<Node> queued;
+    quint32 highest = 0;
+    if (m_interesting > 0)
+    {
+        std::priority_queue<Entry> queue = m_queue;
+        while (!queue.empty())
+        {
+            queued.append(queue.top().node);
+            highest = qMax(highest, generation(queue.top().node));
+            queue.pop();
+        }
+    }
+
+    // only an ancestor of a queued commit can be reached again, and in
+    // topological order no returned commit is one
+    QList<Node> returned;
+    if (m_order == TimeOrder)
+    {
+        foreach (Node n, m_popped)
+        {
+            if (generation(n) < highest)
+            {
+                returned.append(n);
+            }
+        }
+    }
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::BigEndian);
+    out.writeRawData(CursorMagic, sizeof(CursorMagic));
+    out << CursorVersion << quint8(m_order) << quint32(queued.size()) << quint32(returned.size());
+    foreach (Node n, queued + returned)
+    {
+        out.writeRawData(reinterpret_cast<const char*>(oid(n).constData()->id), GIT_OID_RAWSZ);
+        out << quint8((flags(n) & Hidden) ? 1 : 0);
+    }
+    return data;
+}
+
+void QGitTopoWalk::resume(const QByteArray& cursor)
+{
+    QDataStream in(cursor);
+    in.setByteOrder(QDataStream::BigEndian);
+
+    char magic[sizeof(CursorMagic)];
+    quint32 version = 0, queuedCount = 0, returnedCount = 0;
+    quint8 order = 0;
+    in.readRawData(magic, sizeof(magic));
+    in >> version >> order >> queuedCount >> returnedCount;
+
+    const qint64 entrySize = GIT_OID_RAWSZ + 1;
+    if (in.status() != QDataStream::Ok || memcmp(magic, CursorMagic, sizeof(CursorMagic)) != 0
+            || version != CursorVersion || order > TimeOrder
+            || (qint64(queuedCount) + returnedCount) * entrySize > cursor.size())
+    {
+        giterr_set_str(GITERR_INVALID, "invalid walk cursor");
+        qGitThrow(GIT_ERROR);
+    }
+
+    QList<CursorEntry> entries;
+    for (quint32 i = 0; i < queuedCount + returnedCount; ++i)
+    {
+        git_oid oid;
+        quint8 hidden = 0;
+        in.readRawData(reinterpret_cast<char*>(oid.id), GIT_OID_RAWSZ);
+        in >> hidden;
+
+        CursorEntry entry;
+        entry.oid = QGitOId(&oid);
+        entry.hidden = hidden != 0;
+        entries.append(entry);
+    }
+
+    if (in.status() != QDataStream::Ok)
+    {
+        giterr_set_str(GITERR_INVALID, "invalid walk cursor");
+        qGitThrow(GIT_ERROR);
+    }
+
+    m_pushed.clear();
+    m_hidden.clear();
+    m_order = Order(order);
+    m_resumeQueued = entries.mid(0, int(queuedCount));
+    m_resumeReturned = entries.mid(int(queuedCount));
+    m_prepared = false;
+}
+
+void QGitTopoWalk::parseMissing(const QList<QGitOId>& tips)
+{
+    m_parsedIndex.clear();
+    m_parsedOids.clear();
+    m_parsedTimes.clear();
+    m_parsedGenerations.clear();
+    m_parsedParentBegin.clear();
+    m_parsedParents.clear();
+
+    ParseState state;
+    state.graph = (m_graph && m_graph->isOpen()) ? m_graph : 0;
+    foreach (const QGitOId &tip, tips)
+    {
+        if (!state.index.contains(tip) && !state.inGraph(tip))
+        {
+            state.index.insert(tip, state.parsed.size());
+            state.parsed.append(ParseState::Parsed());
+            state.pending.append(tip);
+        }
+    }
+
+    if (state.pending.isEmpty())
+    {
+        return;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(m_maxThreads);
+    for (int i = 0; i < m_maxThreads; ++i)
+    {
+        pool.start(new ParseWorker(&state, m_repo.path()));
+    }
+    pool.waitForDone();
+
+    if (!state.error.isEmpty())
+    {
+        giterr_set_str(GITERR_INVALID, state.error.toUtf8().constData());
+        qGitThrow(GIT_ERROR);
+    }
+
+    const int count = state.parsed.size();
+    m_parsedIndex = state.index;
+    m_parsedOids.resize(count);
+    m_parsedTimes.resize(count);
+    for (QHash<QGitOId, int>::const_iterator it = state.index.constBegin(); it != state.index.constEnd(); ++it)
+    {
+        m_parsedOids[it.value()] = it.key();
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        const ParseState::Parsed &parsed = state.parsed.at(i);
+        m_parsedTimes[i] = parsed.time;
+        m_parsedParentBegin.append(m_parsedParents.size());
+        foreach (const QGitOId &parent, parsed.parents)
+        {
+            m_parsedParents.append(node(parent));
+        }
+    }
+    m_parsedParentBegin.append(m_parsedParents.size());
+
+    // exact generations, parents first; graph commits already have theirs
+    m_parsedGenerations.fill(0, count);
+    QVector<int> stack;
+    for (int i = 0; i < count; ++i)
+    {
+        stack.append(i);
+        while (!stack.isEmpty())
+        {
+            const int top = stack.last();
+            if (m_parsedGenerations.at(top) != 0)
+            {
+                stack.pop_back();
+                continue;
+            }
+
+            quint32 highest = 0;
+            bool ready = true;
+            for (int e = m_parsedParentBegin.at(top); e < m_parsedParentBegin.at(top + 1); ++e)
+            {
+                const Node parent = m_parsedParents.at(e);
+                if (parent < 0 && m_parsedGenerations.at(-parent - 2) == 0)
+                {
+                    stack.append(-parent - 2);
+                    ready = false;
+                }
+                else
+                {
+                    highest = qMax(highest, generation(parent));
+                }
+            }
+
+            if (ready)
+            {
+                m_parsedGenerations[top] = highest + 1;
+                stack.pop_back();
+            }
+        }
+    }
+}
+
+QGitTopoWalk::Node QGitTopoWalk::node(const QGitOId& oid) const
+{
+    if (m_graph && m_graph->isOpen())
+    {
+        const int pos = m_graph->find(oid);
+        if (pos != QGitCommitGraph::NotFound)
+        {
+            return pos;
+        }
+    }
+
+    QHash<QGitOId, int>::const_iterator it = m_parsedIndex.constFind(oid);
+    if (it == m_parsedIndex.constEnd())
+    {
+        giterr_set_str(GITERR_INVALID, "commit missing from the walk");
+        qGitThrow(GIT_ERROR);
+    }
+    return -it.value() - 2;
+}
+
+QGitOId QGitTopoWalk::oid(Node node) const
+{
+    return node >= 0 ? m_graph->oid(node) : m_parsedOids.at(-node - 2);
+}
+
+quint32 QGitTopoWalk::generation(Node node) const
+{
+    return node >= 0 ? m_graph->generation(node) : m_parsedGenerations.at(-node - 2);
+}
+
+qint64 QGitTopoWalk::time(Node node) const
+{
+    return node >= 0 ? m_graph->time(node) : m_parsedTimes.at(-node - 2);
+}
+
+void QGitTopoWalk::parents(Node node, QVector<Node>& out) const
+{
+    out.clear();
+    if (node >= 0)
+    {
+        const int count = m_graph->parentCount(node);
+        for (int n = 0; n < count; ++n)
+        {
+            const int parent = m_graph->parent(node, n);
+            if (parent != QGitCommitGraph::NotFound)
+            {
+                out.append(parent);
+            }
+        }
+        return;
+    }
+
+    const int i = -node - 2;
+    for (int e = m_parsedParentBegin.at(i); e < m_parsedParentBegin.at(i + 1); ++e)
+    {
+        out.append(m_parsedParents.at(e));
+    }
+}
+
+uchar& QGitTopoWalk::flags(Node node)
+{
+    if (node >= 0)
+    {
+        return reinterpret_cast<uchar*>(m_graphFlags.data())[node];
+    }
+    return reinterpret_cast<uchar*>(m_parsedFlags.data())[-node - 2];
+}
+
+void QGitTopoWalk::enqueue(Node node, bool hidden)
+{
+    uchar &f = flags(node);
+    if (f & Seen)
+    {
+        // hidden-ness only flows down from commits popped earlier
+        if (hidden && !(f & Hidden))
+        {
+            f |= Hidden;
+            if (!(f & Popped))
+            {
+                --m_interesting;
+            }
+        }
+        return;
+    }
+
+    f = Seen | (hidden ? Hidden : 0);
+    if (!hidden)
+    {
+        ++m_interesting;
+    }
+
+    Entry entry;
+    entry.node = node;
+    if (m_order == TopologicalOrder)
+    {
+        entry.primary = generation(node);
+        entry.secondary = time(node);
+    }
+    else
+    {
+        entry.primary = time(node);
+        entry.secondary = generation(node);
+    }
+    m_queue.push(entry);
+}
+
+void QGitTopoWalk::prepare()
+{
+    m_queue = std::priority_queue<Entry>();
+    m_popped.clear();
+    m_interesting = 0;
+
+    QList<QGitOId> tips = m_hidden + m_pushed;
+    foreach (const CursorEntry &entry, m_resumeQueued + m_resumeReturned)
+    {
+        tips.append(entry.oid);
+    }
+    parseMissing(tips);
+
+    m_graphFlags.fill(0, (m_graph && m_graph->isOpen()) ? m_graph->count() : 0);
+    m_parsedFlags.fill(0, m_parsedOids.size());
+
+    // commits returned before the cursor was saved are walked already
+    foreach (const CursorEntry &entry, m_resumeReturned)
+    {
+        const Node n = node(entry.oid);
+        flags(n) = Seen | Popped | (entry.hidden ? Hidden : 0);
+        m_popped.append(n);
+    }
+    foreach (const CursorEntry &entry, m_resumeQueued)
+    {
+        if (entry.hidden)
+        {
+            enqueue(node(entry.oid), true);
+        }
+    }
+    foreach (const CursorEntry &entry, m_resumeQueued)
+    {
+        if (!entry.hidden)
+        {
+            enqueue(node(entry.oid), false);
+        }
+    }
+
+    foreach (const QGitOId &oid, m_hidden)
+    {
+        enqueue(node(oid), true);
+    }
+    foreach (const QGitOId &oid, m_pushed)
+    {
+        enqueue(node(oid), false);
+    }
+
+    m_prepared = true;
+}
+
+bool QGitTopoWalk::next(QGitOId& oid)
+{
+    if (!m_prepared)
+    {
+        prepare();
+    }
+
+    QVector<Node> nodes;
+    while (m_interesting > 0 && !m_queue.empty())
+    {
+        const Node current = m_queue.top().node;
+        m_queue.pop();
+
+        uchar &f = flags(current);
+        f |= Popped;
+        m_popped.append(current);
+        const bool hidden = f & Hidden;
+        if (!hidden)
+        {
+            --m_interesting;
+        }
+
+        parents(current, nodes);
+        foreach (Node parent, nodes)
+        {
+            enqueue(parent, hidden);
+        }
+
+        if (!hidden)
+        {
+            oid = this->oid(current);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace LibQGit2
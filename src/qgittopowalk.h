@@ -0,0 +1,190 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef LIBQGIT2_TOPOWALK_H
+#define LIBQGIT2_TOPOWALK_H
+
+#include "../libqgit2_export.h"
+
+#include "qgitrepository.h"
+#include "qgitoid.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QVector>
+
+#include <queue>
+
+namespace LibQGit2
+{
+    class QGitCommitGraph;
+
+    /**
+     * @brief Streaming history walk ordered by generation numbers.
+     *
+     * Unlike QGitRevWalk with the Topological flag, this walker does not load
+     * the whole history before returning the first commit. Commits are kept
+     * in a queue ordered by generation number: every child has a higher
+     * generation than its parents, so popping the highest generation first
+     * yields a topological order one commit at a time.
+     *
+     * Generations come from the commit graph. Commits newer than the graph
+     * (or all commits, when there is no graph) are parsed up front, in
+     * parallel, until the walk reaches commits the graph knows; each worker
+     * thread reads from its own repository handle.
+     *
+     * The position of a walk can be saved with cursor() and restored later,
+     * on another walker, with resume(); the resumed walk only visits the
+     * commits it returns, so paging through history costs each page once.
+     *
+     * @ingroup LibQGit2
+     * @{
+     */
+    class LIBQGIT2_REVWALK_EXPORT QGitTopoWalk
+    {
+        public:
+            enum Order
+            {
+                TopologicalOrder,   //!< by generation, then commit time; children always first
+                TimeOrder           //!< by commit time, like GIT_SORT_TIME
+            };
+
+            /**
+             * @param graph commit graph to take generations and parents from;
+             * not owned, must outlive the walk. May be null or closed.
+             */
+            explicit QGitTopoWalk(const QGitRepository& repository, const QGitCommitGraph *graph = 0);
+
+            ~QGitTopoWalk();
+
+            void setOrder(Order order);
+
+            /**
+             * Number of threads used to parse commits missing from the graph.
+             * Defaults to QThread::idealThreadCount().
+             */
+            void setMaxThreads(int count);
+
+            /**
+             * Start the walk at commit. Resets a walk in progress.
+             */
+            void push(const QGitOId& commit);
+
+            /**
+             * Leave commit and its ancestors out of the walk. In TimeOrder the
+             * exclusion is only exact when commit times do not go backwards.
+             */
+            void hide(const QGitOId& commit);
+
+            /**
+             * Forget the pushed and hidden commits, and any resumed cursor.
+             */
+            void reset();
+
+            /**
+             * Save the position of the walk: the commits queued to be walked,
+             * plus the few already returned ones the walk could reach again
+             * (only possible in TimeOrder, when commit times go backwards).
+             * @throws QGitException
+             */
+            QByteArray cursor();
+
+            /**
+             * Continue the walk from a cursor. The pushed and hidden commits
+             * are replaced, and the order is the one of the saved walk.
+             * @throws QGitException if cursor is not valid
+             */
+            void resume(const QByteArray& cursor);
+
+            /**
+             * Get the next commit of the walk.
+             * @return false once the walk is over
+             * @throws QGitException
+             */
+            bool next(QGitOId& oid);
+
+        private:
+            enum Flag
+            {
+                Seen    = 0x1,
+                Hidden  = 0x2,
+                Popped  = 0x4
+            };
+
+            /**
+             * A commit is its position in the graph (>= 0), or -(index + 2)
+             * in the list of parsed commits.
+             */
+            typedef int Node;
+
+            struct CursorEntry
+            {
+                QGitOId oid;
+                bool hidden;
+            };
+
+            struct Entry
+            {
+                qint64 primary;
+                qint64 secondary;
+                Node node;
+
+                bool operator<(const Entry& other) const;
+            };
+
+            void prepare();
+            void parseMissing(const QList<QGitOId>& tips);
+            Node node(const QGitOId& oid) const;
+            QGitOId oid(Node node) const;
+            quint32 generation(Node node) const;
+            qint64 time(Node node) const;
+            void parents(Node node, QVector<Node>& out) const;
+            uchar& flags(Node node);
+            void enqueue(Node node, bool hidden);
+
+            QGitRepository m_repo;
+            const QGitCommitGraph *m_graph;
+            Order m_order;
+            int m_maxThreads;
+            QList<QGitOId> m_pushed;
+            QList<QGitOId> m_hidden;
+            QList<CursorEntry> m_resumeQueued;
+            QList<CursorEntry> m_resumeReturned;
+            bool m_prepared;
+
+            // commits the graph does not know
+            QHash<QGitOId, int> m_parsedIndex;
+            QVector<QGitOId> m_parsedOids;
+            QVector<qint64> m_parsedTimes;
+            QVector<quint32> m_parsedGenerations;
+            QVector<int> m_parsedParentBegin;
+            QVector<Node> m_parsedParents;
+
+            QByteArray m_graphFlags;
+            QByteArray m_parsedFlags;
+            std::priority_queue<Entry> m_queue;
+            QVector<Node> m_popped;
+            int m_interesting;
+    };
+
+    /**@}*/
+}
+
+#endif // LIBQGIT2_TOPOWALK_H
@@ -0,0 +1,12 @@
+TEMPLATE = app
+TARGET = tst_qgitdiff
+QT += testlib
+QT -= gui
+CONFIG += testcase console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../.. ../../src
+LIBS += -L../.. -lqgit2 -L /usr/lib -lgit2
+QMAKE_CXXFLAGS += -std=c++11
+
+SOURCES += tst_qgitdiff.cpp
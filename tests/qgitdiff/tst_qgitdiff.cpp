@@ -0,0 +1,94 @@
+/******************************************************************************
+ * This file is part of the Gluon Development Platform
+ * Copyright (c) 2011 Laszlo Papp <djszapi@archlinux.us>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "qgit2.h"
+
+#include <QtCore/QTemporaryDir>
+#include <QtTest/QtTest>
+
+#include <git2/tree.h>
+
+using namespace LibQGit2;
+
+class TestQGitDiff : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void copiesFromUnmodifiedListOnlyChangedFiles();
+
+private:
+    QGitTree makeTree(const QList<QPair<QByteArray, QByteArray> > &files);
+
+    QTemporaryDir m_dir;
+    QGitRepository m_repo;
+};
+
+void TestQGitDiff::init()
+{
+    QVERIFY(m_dir.isValid());
+    m_repo.init(m_dir.path(), true);
+}
+
+QGitTree TestQGitDiff::makeTree(const QList<QPair<QByteArray, QByteArray> > &files)
+{
+    git_treebuilder *builder = NULL;
+    qGitThrow(git_treebuilder_create(&builder, NULL));
+
+    typedef QPair<QByteArray, QByteArray> File;
+    foreach (const File &file, files)
+    {
+        const QGitOId blob = m_repo.createBlobFromBuffer(file.second);
+        qGitThrow(git_treebuilder_insert(NULL, builder, file.first.constData(), blob.constData(),
+                                         GIT_FILEMODE_BLOB));
+    }
+
+    git_oid oid;
+    const int err = git_treebuilder_write(&oid, m_repo.data(), builder);
+    git_treebuilder_free(builder);
+    qGitThrow(err);
+
+    return m_repo.lookupTree(QGitOId(&oid));
+}
+
+void TestQGitDiff::copiesFromUnmodifiedListOnlyChangedFiles()
+{
+    QList<QPair<QByteArray, QByteArray> > files;
+    files << qMakePair(QByteArray("a.txt"), QByteArray("one\ntwo\nthree\n"))
+          << qMakePair(QByteArray("b.txt"), QByteArray("unchanged\n"))
+          << qMakePair(QByteArray("c.txt"), QByteArray("also unchanged\n"));
+    const QGitTree before = makeTree(files);
+
+    files[0].second = "one\n2\nthree\n";
+    const QGitTree after = makeTree(files);
+
+    QGitDiff diff(m_repo);
+    diff.setSimilarityDetection(QGitDiff::FindCopiesFromUnmodified);
+    diff.diffTrees(before, after);
+
+    QCOMPARE(diff.result().fileCount(), 1);
+    QCOMPARE(diff.getFileChangedList(), QStringList() << QLatin1String("a.txt"));
+    QCOMPARE(diff.stats().fileCount(), 1);
+    QCOMPARE(diff.printRaw().count("diff --git"), 1);
+}
+
+QTEST_MAIN(TestQGitDiff)
+
+#include "tst_qgitdiff.moc"